@@ -0,0 +1,72 @@
+#include <genieArduinoDEV.h>
+
+// This sketch benchmarks the Genie_Frame_Buffer queue used by the library for outgoing and incoming frames.
+// No display is needed, results are printed to Serial.
+
+// Every WriteObject, ReadObject and reported event looks for a queued frame with the same cmd, object and index
+// and replaces it, so only the newest value is sent. The plain buffer scans every queued frame to do this, while
+// the keyed buffer (the one Genie uses) keeps a hash index over those three bytes.
+// The queue is filled to 75% with frames for different widgets, then replace() is timed for widgets that are
+// queued (hit) and widgets that are not (miss), for queue sizes well past the default MAX_GENIE_EVENTS of 16.
+
+#define ROUNDS 2000
+
+template <typename Buffer>
+void fill(Buffer &queue)
+{
+  queue.clear();
+  for (uint16_t i = 0; i < queue.capacity() * 3 / 4; i++)
+  {
+    uint8_t frame[7] = { 0, GENIE_WRITE_OBJ, (uint8_t)(i / 64), (uint8_t)(i % 64), 0, 0, 0 };
+    queue.push_back(frame, 7);
+  }
+}
+
+template <typename Buffer>
+float timeReplace(Buffer &queue, bool hit)
+{
+  uint16_t queued = queue.capacity() * 3 / 4;
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < ROUNDS; i++)
+  {
+    uint16_t widget = hit ? (i * 7) % queued : queued + i % 64; // hits are spread over the whole queue
+    uint8_t frame[7] = { 0, GENIE_WRITE_OBJ, (uint8_t)(widget / 64), (uint8_t)(widget % 64), (uint8_t)(i >> 8), (uint8_t)i, 0 };
+    queue.template replace<1,2,3>(frame, 7);
+  }
+  return (float)(micros() - start) / ROUNDS;
+}
+
+template <uint16_t SIZE>
+void benchmark()
+{
+  static Genie_Frame_Buffer<uint8_t, SIZE, 7> plain;
+  static Genie_Frame_Buffer<uint8_t, SIZE, 7, 1, 2, 3> keyed;
+
+  fill(plain);
+  fill(keyed);
+  Serial.print(SIZE);
+  Serial.print("\t");
+  Serial.print(timeReplace(plain, true), 2);
+  Serial.print("\t\t");
+  Serial.print(timeReplace(keyed, true), 2);
+  Serial.print("\t\t");
+  Serial.print(timeReplace(plain, false), 2);
+  Serial.print("\t\t");
+  Serial.println(timeReplace(keyed, false), 2);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000);
+
+  Serial.println("Genie_Frame_Buffer replace(), microseconds per call");
+  Serial.println("size\tplain hit\tkeyed hit\tplain miss\tkeyed miss");
+  benchmark<16>();
+  benchmark<64>();
+  benchmark<256>();
+}
+
+void loop()
+{
+}
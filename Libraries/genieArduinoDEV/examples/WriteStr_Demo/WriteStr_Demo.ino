@@ -53,41 +53,46 @@ void loop()
   float temperature2 = 12.3;
   String Str = "This is string class";
   genie.WriteStr(0, "TEST");	// Write to String0 Object, with the string "TEST"
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, z, digits); //3 decimal places
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, 123.45678, 5); // 5 decimal places
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, 123.45678); // 2 decimal places by default if no value is given to decimal place.
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, F("This string will be \n stored in flash memory")); // For AVR Arduinos only - Needs to be commented out for Due, Chipkit, Teensy etc.
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, "                                                        "); // Clear
-  delay(10);
+  waitEvents(10);
   genie.WriteStr(0, x); //prints negative integer
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, y);
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, -x, BIN); //base 2 of 78
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, y,16); //base 16
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, 10); //base 10 by default
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, 10,8); //base 8
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, Str); //prints String Class
-  delay(1000);
+  waitEvents(1000);
   unsigned int zc = 123 ;
   genie.WriteStr(0, zc); //prints unsigned ints
-  delay(1000);
+  waitEvents(1000);
   unsigned long e = 1234 ;
   genie.WriteStr(0, e); //prints unsigned long
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, (String) temperature1 + (String) "\xB0"); // 150 with degree symbol (Standard Arial ANSI font, not Unicode)
-  delay(1000);
+  waitEvents(1000);
   genie.WriteStr(0, (String) temperature2 + char(176) ); // same as above, done slightly differently
-  delay(1000);
+  waitEvents(1000);
 }
 
-
+// Keep the library processing the queued writes while waiting
+void waitEvents(uint32_t ms)
+{
+  uint32_t start = millis();
+  while (millis() - start < ms) genie.DoEvents();
+}
@@ -0,0 +1,115 @@
+// Host stand-in for the parts of the Arduino core used by genieArduinoDEV,
+// so the library can be compiled and exercised on a workstation together
+// with GenieSimDisplay. Not used by Arduino builds.
+//
+// Time is virtual: every micros()/millis() read advances the clock by
+// genie_host::tick_us (1us by default), delay() advances it by the delay,
+// so busy-wait loops in the library terminate and runs are repeatable.
+
+#ifndef GENIE_HOST_ARDUINO_H
+#define GENIE_HOST_ARDUINO_H
+
+#define GENIE_HOST 1
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+namespace genie_host {
+  inline uint64_t &clock_us() { static uint64_t t = 0; return t; }
+  inline uint32_t &tick_us() { static uint32_t t = 1; return t; }
+  inline uint64_t now() { return clock_us(); } /* read without advancing */
+  inline void advance(uint64_t us) { clock_us() += us; }
+}
+
+inline unsigned long micros() { genie_host::advance(genie_host::tick_us()); return (uint32_t)genie_host::now(); }
+inline unsigned long millis() { genie_host::advance(genie_host::tick_us()); return (uint32_t)(genie_host::now() / 1000); }
+inline void delay(unsigned long ms) { genie_host::advance((uint64_t)ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { genie_host::advance(us); }
+inline void yield() {}
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class String : public std::string {
+  public:
+    String(const char *s = "") : std::string(s) {}
+    String(const std::string &s) : std::string(s) {}
+    String(char c) : std::string(1, c) {}
+    String(int value) : std::string(std::to_string(value)) {}
+    String(long value) : std::string(std::to_string(value)) {}
+    String(unsigned int value) : std::string(std::to_string(value)) {}
+    String(unsigned long value) : std::string(std::to_string(value)) {}
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) { size_t n = 0; while ( size-- ) n += write(*buffer++); return n; }
+    size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(const __FlashStringHelper *s) { return write((const char *)s); }
+    size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC) {
+      if ( base == DEC && n < 0 ) return print('-') + print((unsigned long)-n, base);
+      return print((unsigned long)n, base);
+    }
+    size_t print(unsigned long n, int base = DEC) {
+      char buf[8 * sizeof(long) + 1], *p = &buf[sizeof(buf) - 1];
+      *p = '\0';
+      if ( base < 2 ) base = 10;
+      do { uint8_t d = n % base; n /= base; *--p = d < 10 ? '0' + d : 'A' + d - 10; } while ( n );
+      return write(p);
+    }
+    size_t print(double n, int digits = 2) { char buf[48]; snprintf(buf, sizeof(buf), "%.*f", digits, n); return write(buf); }
+
+    size_t println() { return write("\r\n"); }
+    template<typename V> size_t println(V value) { size_t n = print(value); return n + println(); }
+    template<typename V> size_t println(V value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    using Print::write;
+};
+
+class HardwareSerial : public Stream {
+  public:
+    virtual void begin(unsigned long baud) = 0;
+    virtual void end() {}
+    operator bool() { return true; }
+};
+
+// Serial prints to stdout
+class GenieHostConsole : public HardwareSerial {
+  public:
+    void begin(unsigned long) override {}
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    using Print::write;
+};
+static GenieHostConsole Serial;
+
+#endif // GENIE_HOST_ARDUINO_H
@@ -0,0 +1,84 @@
+// DoEvents throughput against the simulated display, for tracking between releases.
+//
+// For each baud rate, 16 gauges are written with a new value every loop for
+// SECONDS of simulated time. Reports the frames the display acknowledged per
+// second, the stop-and-wait limit of the link (frame + ACK + display delay)
+// and the host CPU time spent per DoEvents call.
+//
+// A second table writes the same 16 gauges as one WriteObjects batch per
+// loop, to a MagicObject running the batch handler, and reports widget
+// updates per second against the single frame writes above.
+//
+// Build from the library folder (see README.md in this folder):
+//    g++ -std=gnu++11 -O2 -Iextras/host -Isrc extras/host/DoEventsBenchmark.cpp src/genieArduinoDEV.cpp -o doevents_bench
+
+#include "Arduino.h"
+#include "GenieSimDisplay.h"
+#include "genieArduinoDEV.h"
+#include <chrono>
+
+#define SECONDS   5
+#define WIDGETS   16
+
+static double benchmark(uint32_t baud) {
+  GenieSimDisplay display;
+  Genie genie;
+  display.baud = baud;
+  display.begin(baud);
+  if ( !genie.Begin(display) ) {
+    printf("%u\tdisplay not detected\n", baud);
+    return 0;
+  }
+
+  uint32_t acks = display.acks, calls = 0;
+  uint64_t start = genie_host::now();
+  auto cpu_start = std::chrono::steady_clock::now();
+  for ( uint16_t value = 0; genie_host::now() - start < SECONDS * 1000000ULL; value++ ) {
+    genie.WriteObject(GENIE_OBJ_GAUGE, value % WIDGETS, value);
+    genie.DoEvents();
+    calls++;
+  }
+  double cpu_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - cpu_start).count();
+
+  double byte_us = 10000000 / baud; /* whole microseconds, as the simulated line */
+  double limit = 1000000.0 / ( 7 * byte_us + display.response_delay_us ); /* 6 byte frame, 1 byte ACK */
+  double fps = (double)( display.acks - acks ) / SECONDS;
+  printf("%u\t%.0f\t\t%.0f\t\t%.0f%%\t\t%.0f\n", baud, fps, limit, 100 * fps / limit, cpu_ns / calls);
+  return fps;
+}
+
+static void benchmark_batched(uint32_t baud, double single) {
+  GenieSimDisplay display;
+  Genie genie;
+  display.baud = baud;
+  display.batch_magic = 0;
+  display.begin(baud);
+  if ( !genie.Begin(display) ) {
+    printf("%u\tdisplay not detected\n", baud);
+    return;
+  }
+
+  GenieWrite writes[WIDGETS];
+  uint32_t updates = 0;
+  uint16_t value = 0;
+  uint64_t start = genie_host::now();
+  while ( genie_host::now() - start < SECONDS * 1000000ULL ) {
+    value++;
+    for ( uint8_t i = 0; i < WIDGETS; i++ ) writes[i] = { GENIE_OBJ_GAUGE, i, (uint16_t)(value + i) };
+    uint16_t ticket = genie.WriteObjects(0, writes, WIDGETS);
+    while ( genie.GetWriteStatus(ticket) < GENIE_TX_ACKED && genie_host::now() - start < SECONDS * 1000000ULL ) genie.DoEvents();
+    if ( genie.GetWriteStatus(ticket) == GENIE_TX_ACKED ) updates += WIDGETS;
+  }
+  double ups = (double)updates / SECONDS;
+  printf("%u\t%.0f\t\t%.1fx\n", baud, ups, single ? ups / single : 0);
+}
+
+int main() {
+  const uint32_t bauds[] = { 9600, 38400, 115200, 256000, 600000 };
+  double single[sizeof(bauds) / sizeof(bauds[0])];
+  printf("baud\tframes/s\tlink limit\tefficiency\tns per DoEvents\n");
+  for ( uint8_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++ ) single[i] = benchmark(bauds[i]);
+  printf("\n%u widgets per WriteObjects batch\nbaud\tupdates/s\tvs WriteObject\n", WIDGETS);
+  for ( uint8_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++ ) benchmark_batched(bauds[i], single[i]);
+  return 0;
+}
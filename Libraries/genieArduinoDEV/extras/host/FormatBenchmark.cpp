@@ -0,0 +1,115 @@
+// Number formatting used by WriteStr/WriteInhLabel, against the per-overload
+// loops the library had before genie_format_*, on the host CPU.
+//
+// Checks that integers and doubles format identically (the old double loop is
+// the one Print::print(double, digits) uses, so both must print the same text
+// as Print) and times each path. A third row builds a length with its unit the way a sketch would with
+// String, against genie_format_fixed with the unit appended in place.
+//
+// Build from the library folder (see README.md in this folder):
+//    g++ -std=gnu++11 -O2 -Iextras/host -Isrc extras/host/FormatBenchmark.cpp src/genieArduinoDEV.cpp -o format_bench
+
+#include "Arduino.h"
+#include "genieArduinoDEV.h"
+#include <chrono>
+
+#define COUNT   2000000
+
+// WriteStr(uint16_t, long) before genie_format_long
+static char* legacy_long(char *buf, size_t size, long n) {
+  char *str = &buf[size - 1];
+  long N = n;
+  n = labs(n);
+  *str = '\0';
+  do {
+    unsigned long m = n;
+    n /= 10;
+    char c = m - 10 * n;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while ( n );
+  if ( N < 0 ) *--str = '-';
+  return str;
+}
+
+// WriteStr(uint16_t, double, int) before genie_format_double
+static char* legacy_double(char *buf, size_t size, double number, int digits) {
+  char *str = &buf[size - 1];
+  *str = '\0';
+  double number2 = number;
+  if ( number < 0.0 ) number = -number;
+  double rounding = 0.5;
+  for ( int i = 0; i < digits; ++i ) rounding /= 10.0;
+  number += rounding;
+  unsigned long int_part = (unsigned long)number;
+  double remainder = number - (double)int_part;
+  int digits2 = digits;
+  str = &buf[size - 1 - digits2];
+  while ( digits2-- > 0 ) {
+    remainder *= 10.0;
+    int toPrint = int(remainder);
+    *str++ = toPrint + 48;
+    remainder -= toPrint;
+  }
+  str = &buf[size - 1 - digits];
+  if ( digits > 0 ) *--str = '.';
+  do {
+    unsigned long m = int_part;
+    int_part /= 10;
+    char c = m - 10 * int_part;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while ( int_part );
+  if ( number2 < 0.0 ) *--str = '-';
+  return str;
+}
+
+static volatile size_t sink;
+static volatile int decimals = 2; /* not a constant the compiler can fold into legacy_double */
+
+template<typename F> static double time_ns(F f) {
+  auto start = std::chrono::steady_clock::now();
+  for ( long i = 0; i < COUNT; i++ ) f(i);
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / COUNT;
+}
+
+static long sample(long i) { return ( i * 2654435761UL ) % 2000001 - 1000000; } /* spread over +-1e6 */
+
+int main() {
+  char a[GENIE_NUMBER_SIZE], b[GENIE_NUMBER_SIZE];
+  long mismatches = 0;
+  for ( long i = 0; i < COUNT; i++ ) {
+    b[sizeof(b) - 1] = '\0';
+    if ( strcmp(legacy_long(a, sizeof(a), sample(i)), genie_format_long(&b[sizeof(b) - 1], sample(i))) ) mismatches++;
+  }
+  printf("integers differing: %ld of %d\n", mismatches, COUNT);
+
+  mismatches = 0;
+  for ( long i = 0; i < COUNT; i++ ) {
+    b[sizeof(b) - 1] = '\0';
+    const char *old_text = legacy_double(a, sizeof(a), sample(i) / 1000.0, 2);
+    const char *new_text = genie_format_double(&b[sizeof(b) - 1], sample(i) / 1000.0, 2);
+    if ( strcmp(old_text, new_text) && mismatches++ < 3 ) printf("  %.6f: old \"%s\" new \"%s\"\n", sample(i) / 1000.0, old_text, new_text);
+  }
+  printf("doubles (2 decimals) differing: %ld of %d\n\n", mismatches, COUNT);
+
+  printf("ns per number\t\told\tnew\n");
+  double old_ns = time_ns([&](long i) { sink = (size_t)legacy_long(a, sizeof(a), sample(i)); });
+  double new_ns = time_ns([&](long i) { sink = (size_t)genie_format_long(&b[sizeof(b) - 1], sample(i)); });
+  printf("long\t\t\t%.1f\t%.1f\n", old_ns, new_ns);
+  old_ns = time_ns([&](long i) { sink = (size_t)legacy_double(a, sizeof(a), sample(i) / 100.0, decimals); });
+  new_ns = time_ns([&](long i) { sink = (size_t)genie_format_double(&b[sizeof(b) - 1], sample(i) / 100.0, decimals); });
+  printf("double, 2 decimals\t%.1f\t%.1f\n", old_ns, new_ns);
+
+  const char *units = " mm";
+  old_ns = time_ns([&](long i) { /* String(UserDist / 100) + "." + String(UserDist % 100) + Units, heap allocated */
+    long v = labs(sample(i));
+    String text = String(v / 100) + "." + String(v % 100 < 10 ? "0" : "") + String(v % 100) + units;
+    sink = text.length();
+  });
+  new_ns = time_ns([&](long i) { /* as WriteStrFixed(index, UserDist, 2, Units) */
+    char text[GENIE_NUMBER_SIZE + 3];
+    memcpy(&text[GENIE_NUMBER_SIZE], units, 3);
+    sink = (size_t)genie_format_fixed(&text[GENIE_NUMBER_SIZE], labs(sample(i)), 2);
+  });
+  printf("length + unit\t\t%.1f\t%.1f\t(String vs genie_format_fixed)\n", old_ns, new_ns);
+  return 0;
+}
@@ -0,0 +1,237 @@
+// Simulated ViSi-Genie display for host builds (see Arduino.h in this folder).
+//
+// Pass it to Genie::Begin in place of the serial port. It decodes the frames
+// the library writes, keeps forms, widget values and strings, answers with
+// ACK/NAK or reports, and injects line errors on request. Bytes travel at the
+// simulated baud rate on the virtual clock, so timing behaves like a real link.
+//
+//    GenieSimDisplay display;
+//    display.baud = 115200;
+//    display.begin(115200);
+//    genie.Begin(display);
+//    display.event(GENIE_OBJ_4DBUTTON, 0, 1); // user presses a button
+//    display.batch_magic = 0; // MagicObject0 applies WriteObjects batches
+
+#ifndef GENIE_SIM_DISPLAY_H
+#define GENIE_SIM_DISPLAY_H
+
+#include "Arduino.h"
+#include "genieArduinoDEV.h"
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+class GenieSimDisplay : public HardwareSerial {
+  public:
+    // link
+    uint32_t      baud = 9600; /* rate the display is programmed with */
+    uint32_t      response_delay_us = 200; /* display processing time before each reply */
+    uint32_t      byte_gap_us = 0; /* extra idle time between reply bytes */
+    uint32_t      frame_timeout_us = 20000; /* a partial frame idle this long is discarded */
+    bool          connected = 1; /* 0 = unplugged, nothing is received or answered */
+    int16_t       batch_magic = -1; /* MagicObject running the WriteObjects handler, -1 = none */
+    uint16_t      tx_buffer = 0; /* host UART transmit buffer, write() blocks while it is full; 0 = unlimited */
+    bool          tx_room_reported = 1; /* availableForWrite() reports the free space, as most cores do */
+
+    // error injection, probability per byte or per frame (0..1)
+    float         drop_rate = 0; /* byte lost on the line, either direction */
+    float         corrupt_rate = 0; /* byte with one bit flipped, either direction */
+    float         nak_rate = 0; /* valid frame rejected anyway */
+
+    // counters
+    uint32_t      frames = 0; /* complete frames received */
+    uint32_t      acks = 0;
+    uint32_t      naks = 0;
+    uint32_t      reads = 0; /* GENIE_READ_OBJ answered, pings included */
+
+    void          seed(uint32_t s) { rng = s ? s : 1; }
+
+    // display state
+    uint8_t       form = 0;
+    uint8_t       contrast = 15;
+    uint16_t      value(uint8_t object, uint8_t index) { return values[key(object, index)]; }
+    void          setValue(uint8_t object, uint8_t index, uint16_t v) { values[key(object, index)] = v; }
+    std::string   text(uint8_t index) { return strings[index]; } /* last WriteStr/WriteInhLabel text */
+    std::vector<uint8_t> magic(uint8_t index) { return magics[index]; } /* last magic bytes received */
+
+    // user actions on the touch screen
+    void event(uint8_t object, uint8_t index, uint16_t v) {
+      if ( object == GENIE_OBJ_FORM ) form = v;
+      else setValue(object, index, v);
+      reply_frame(GENIE_REPORT_EVENT, object, index, v);
+    }
+    void magicReport(uint8_t index, const uint8_t *bytes, uint8_t len) {
+      std::vector<uint8_t> r = { GENIEM_REPORT_BYTES, index, len };
+      r.insert(r.end(), bytes, bytes + len);
+      reply(r, 1);
+    }
+
+    // HardwareSerial
+    void begin(unsigned long rate) override { host_baud = rate; }
+    int available() override {
+      update();
+      int n = 0;
+      for ( auto &b : out ) {
+        if ( b.first > genie_host::now() ) break;
+        n++;
+      }
+      return n;
+    }
+    int read() override {
+      if ( !available() ) return -1;
+      uint8_t c = out.front().second;
+      out.pop_front();
+      return c;
+    }
+    int peek() override { return available() ? out.front().second : -1; }
+    int availableForWrite() override {
+      if ( !tx_buffer || !tx_room_reported ) return 0;
+      return tx_buffer - tx_pending();
+    }
+    size_t write(uint8_t c) override { /* buffered like a UART, arrives one byte time later */
+      while ( tx_buffer && tx_pending() >= tx_buffer ) genie_host::advance(1); /* blocked until a byte leaves */
+      uint64_t t = ( tx_free > genie_host::now() ? tx_free : genie_host::now() ) + byte_us(host_baud);
+      tx_free = t;
+      in.push_back(std::make_pair(t, c));
+      return 1;
+    }
+    using Print::write;
+
+  private:
+    uint32_t      host_baud = 9600;
+    uint32_t      rng = 1;
+    uint64_t      tx_free = 0, rx_free = 0;
+    std::deque<std::pair<uint64_t, uint8_t>> in, out;
+    std::vector<uint8_t> frame;
+    uint64_t      frame_last = 0;
+    std::map<uint16_t, uint16_t> values;
+    std::map<uint8_t, std::string> strings;
+    std::map<uint8_t, std::vector<uint8_t>> magics;
+
+    static uint16_t key(uint8_t object, uint8_t index) { return ((uint16_t)object << 8) | index; }
+    static uint64_t byte_us(uint32_t rate) { return rate ? 10000000ULL / rate : 0; }
+    bool chance(float p) {
+      if ( p <= 0 ) return 0;
+      rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+      return ( rng % 1000000 ) < p * 1000000;
+    }
+    int line(uint8_t c) { /* what arrives at the other end, -1 if lost */
+      if ( chance(drop_rate) ) return -1;
+      if ( chance(corrupt_rate) ) c ^= 1 << ( rng % 8 );
+      if ( host_baud != baud ) c = ( c * 37 ) ^ 0x5A; /* wrong rate, framing garbage */
+      return c;
+    }
+
+    uint16_t tx_pending() { /* bytes written but not yet fully on the line */
+      uint16_t n = 0;
+      for ( auto it = in.rbegin(); it != in.rend() && it->first > genie_host::now(); ++it ) n++;
+      return n;
+    }
+
+    void update() { /* feed the display every byte that has arrived by now */
+      while ( in.size() && in.front().first <= genie_host::now() ) {
+        uint64_t t = in.front().first;
+        uint8_t c = in.front().second;
+        in.pop_front();
+        if ( !connected ) continue;
+        int r = line(c);
+        if ( r >= 0 ) receive(r, t);
+      }
+    }
+
+    void receive(uint8_t c, uint64_t t) {
+      if ( frame.size() && t - frame_last > frame_timeout_us ) frame.clear();
+      frame_last = t;
+      frame.push_back(c);
+      size_t need;
+      switch ( frame[0] ) {
+        case GENIE_READ_OBJ: need = 4; break;
+        case GENIE_WRITE_OBJ: need = 6; break;
+        case GENIE_WRITE_CONTRAST: need = 3; break;
+        case GENIE_WRITE_STR:
+        case GENIE_WRITE_INH_LABEL:
+        case GENIEM_WRITE_BYTES: need = ( frame.size() >= 3 ) ? 4 + frame[2] : 4; break;
+        case GENIE_WRITE_STRU:
+        case GENIEM_WRITE_DBYTES: need = ( frame.size() >= 3 ) ? 4 + 2 * frame[2] : 4; break;
+        default: frame.clear(); nak(t); return;
+      }
+      if ( frame.size() < need ) return;
+      frames++;
+      uint8_t checksum = 0;
+      for ( uint8_t b : frame ) checksum ^= b;
+      if ( checksum || chance(nak_rate) ) {
+        frame.clear();
+        nak(t);
+        return;
+      }
+      execute(t);
+      frame.clear();
+    }
+
+    void execute(uint64_t t) {
+      switch ( frame[0] ) {
+        case GENIE_READ_OBJ: {
+            reads++;
+            uint16_t v = ( frame[1] == GENIE_OBJ_FORM ) ? form : value(frame[1], frame[2]);
+            reply_frame(GENIE_REPORT_OBJ, frame[1], frame[2], v, t);
+            return;
+          }
+        case GENIE_WRITE_OBJ: {
+            if ( frame[1] == GENIE_OBJ_FORM ) form = frame[2];
+            else setValue(frame[1], frame[2], ((uint16_t)frame[3] << 8) | frame[4]);
+            break;
+          }
+        case GENIE_WRITE_CONTRAST: contrast = frame[1]; break;
+        case GENIE_WRITE_STR:
+        case GENIE_WRITE_INH_LABEL: strings[frame[1]] = std::string(frame.begin() + 3, frame.end() - 1); break;
+        case GENIE_WRITE_STRU: {
+            std::string s;
+            for ( size_t i = 3; i + 1 < frame.size(); i += 2 ) s += (char)frame[i + 1]; /* low byte only */
+            strings[frame[1]] = s;
+            break;
+          }
+        case GENIEM_WRITE_BYTES:
+        case GENIEM_WRITE_DBYTES: {
+            magics[frame[1]] = std::vector<uint8_t>(frame.begin() + 3, frame.end() - 1);
+            if ( frame[0] != GENIEM_WRITE_DBYTES || frame[1] != batch_magic ) break;
+            for ( size_t i = 3; i + 4 < frame.size(); i += 4 ) { /* as HMIContentRedo/MagicBatchWrite.4dg */
+              if ( frame[i] == GENIE_OBJ_FORM ) form = frame[i + 1];
+              else setValue(frame[i], frame[i + 1], ((uint16_t)frame[i + 2] << 8) | frame[i + 3]);
+            }
+            break;
+          }
+      }
+      acks++;
+      reply({ GENIE_ACK }, 0, t);
+    }
+
+    void nak(uint64_t t) {
+      naks++;
+      reply({ GENIE_NAK }, 0, t);
+    }
+
+    void reply_frame(uint8_t cmd, uint8_t object, uint8_t index, uint16_t v, uint64_t t = 0) {
+      reply({ cmd, object, index, (uint8_t)(v >> 8), (uint8_t)v }, 1, t);
+    }
+
+    void reply(std::vector<uint8_t> bytes, bool checksum, uint64_t t = 0) {
+      if ( !connected ) return;
+      if ( checksum ) {
+        uint8_t c = 0;
+        for ( uint8_t b : bytes ) c ^= b;
+        bytes.push_back(c);
+      }
+      if ( !t ) t = genie_host::now();
+      t += response_delay_us;
+      if ( rx_free > t ) t = rx_free;
+      for ( uint8_t b : bytes ) {
+        t += byte_us(baud) + byte_gap_us;
+        int r = line(b);
+        if ( r >= 0 ) out.push_back(std::make_pair(t, (uint8_t)r));
+      }
+      rx_free = t;
+    }
+};
+
+#endif // GENIE_SIM_DISPLAY_H
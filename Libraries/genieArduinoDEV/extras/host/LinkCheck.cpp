@@ -0,0 +1,232 @@
+// Pass/fail checks for the link handling, against the simulated display.
+//
+// Each line prints what was measured, the limit it is held to and PASS or
+// FAIL, and the program exits with 1 if any check failed:
+//  - pings:     a busy link carries no pings, an idle one is still pinged
+//  - unplug:    SetLinkTimeouts(100, 300) reports a pulled cable in time
+//  - stream:    at 9600 baud with SetLinkTimeouts(100, 200), a 250 character
+//               string that takes longer than the timeout to send is ACKed
+//               without a false disconnect
+//  - priority:  at 9600 baud, a fault LED written behind 10 queued digit
+//               writes reaches the display within 2 frames
+//  - retries:   SEEDS runs of 200 rounds of 8 gauge writes plus one string,
+//               with 0.2% dropped and 0.2% corrupted bytes. No final gauge
+//               value may be lost and no string may fail
+//  - timeout:   on a clean link the measured ACK timeout drops below
+//               GENIE_ACK_TIMEOUT
+//  - replay:    after a 3.5 s unplug and a display reset, the form and
+//               GENIE_SHADOW_SIZE widgets are restored within 50 ms
+//  - reset:     a display that resets without the link going down gets its
+//               widgets back once an idle ping sees the form change
+//
+// The simulated clock and the simulator's random numbers are fixed, so every
+// run prints the same numbers. Built with -DGENIE_TX_RETRIES=0, the retries
+// check shows what is lost without resending, and fails.
+//
+// Build from the library folder (see README.md in this folder):
+//    g++ -std=gnu++11 -O2 -Iextras/host -Isrc extras/host/LinkCheck.cpp src/genieArduinoDEV.cpp -o link_check
+
+#include "Arduino.h"
+#include "GenieSimDisplay.h"
+#include "genieArduinoDEV.h"
+
+#define STARTUP_MS    7500 // past the start-up grace period
+#define SEEDS         8
+
+static uint8_t failures = 0;
+
+static void check(const char *name, uint32_t measured, const char *limit, bool pass) {
+  printf("%-30s\t%u\t%s\t%s\n", name, measured, limit, pass ? "PASS" : "FAIL");
+  if ( !pass ) failures++;
+}
+
+static void run(Genie &genie, uint32_t ms) {
+  uint64_t end = genie_host::now() + ms * 1000ULL;
+  while ( genie_host::now() < end ) genie.DoEvents();
+}
+
+static void pings() {
+  GenieSimDisplay display;
+  Genie genie;
+  display.baud = 115200;
+  display.begin(115200);
+  genie.Begin(display);
+  run(genie, STARTUP_MS);
+
+  uint32_t reads = display.reads;
+  run(genie, 10000);
+  check("idle 10 s, pings", display.reads - reads, "> 0", display.reads > reads);
+
+  reads = display.reads;
+  uint64_t end = genie_host::now() + 10000000ULL;
+  for ( uint16_t value = 0; genie_host::now() < end; value++ ) {
+    genie.WriteObject(GENIE_OBJ_GAUGE, 0, value);
+    run(genie, 5);
+  }
+  check("write every 5 ms, pings", display.reads - reads, "0", display.reads == reads);
+
+  genie.SetLinkTimeouts(100, 300);
+  run(genie, 1000);
+  display.connected = 0;
+  uint64_t start = genie_host::now();
+  while ( genie.IsOnline() && genie_host::now() - start < 5000000ULL ) genie.DoEvents();
+  uint32_t ms = ( genie_host::now() - start ) / 1000;
+  check("unplug detected, ms", ms, "< 400", !genie.IsOnline() && ms < 400);
+}
+
+static void stream() {
+  GenieSimDisplay display;
+  Genie genie;
+  display.baud = 9600;
+  display.tx_buffer = 64; /* as an AVR UART */
+  display.begin(9600);
+  genie.Begin(display);
+  run(genie, STARTUP_MS);
+  genie.SetLinkTimeouts(100, 200);
+  run(genie, 1000);
+
+  char text[251];
+  memset(text, 'x', 250);
+  text[250] = 0;
+  uint64_t start = genie_host::now();
+  uint16_t ticket = genie.WriteStr(0, text);
+  while ( genie.GetWriteStatus(ticket) <= GENIE_TX_SENT && genie.IsOnline() ) genie.DoEvents();
+  uint32_t ms = ( genie_host::now() - start ) / 1000;
+  check("long string, online, ms to ACK", ms, "> 200", genie.GetWriteStatus(ticket) == GENIE_TX_ACKED && genie.IsOnline() && ms > 200);
+}
+
+static void priority() {
+  GenieSimDisplay display;
+  Genie genie;
+  display.baud = 9600;
+  display.begin(9600);
+  genie.Begin(display);
+  run(genie, 50);
+
+  for ( uint8_t i = 0; i < 10; i++ ) genie.WriteObject(GENIE_OBJ_LED_DIGITS, i, 100 + i);
+  uint32_t acks = display.acks;
+  genie.WriteObject(GENIE_OBJ_USER_LED, 0, 1);
+  uint64_t start = genie_host::now();
+  while ( display.value(GENIE_OBJ_USER_LED, 0) != 1 && genie_host::now() - start < 2000000ULL ) genie.DoEvents();
+  check("fault LED behind 10, frames", display.acks - acks, "<= 2", display.value(GENIE_OBJ_USER_LED, 0) == 1 && display.acks - acks <= 2);
+}
+
+static void retries(uint32_t baud) {
+  uint32_t lost = 0, failed = 0;
+  for ( uint32_t seed = 1; seed <= SEEDS; seed++ ) {
+    GenieSimDisplay display;
+    Genie genie;
+    display.seed(seed);
+    display.baud = baud;
+    display.begin(baud);
+    genie.Begin(display);
+    display.drop_rate = 0.002;
+    display.corrupt_rate = 0.002;
+
+    for ( uint16_t round = 0; round < 200; round++ ) {
+      for ( uint8_t i = 0; i < 8; i++ ) genie.WriteObject(GENIE_OBJ_GAUGE, i, round * 8 + i);
+      uint16_t ticket = genie.WriteStr(1, "some status text");
+      while ( genie.GetWriteStatus(ticket) <= GENIE_TX_SENT && genie.IsOnline() ) genie.DoEvents();
+      if ( genie.GetWriteStatus(ticket) != GENIE_TX_ACKED ) failed++;
+      for ( uint16_t i = 0; i < 2000; i++ ) genie.DoEvents();
+      for ( uint8_t i = 0; i < 8; i++ ) if ( display.value(GENIE_OBJ_GAUGE, i) != round * 8 + i ) lost++;
+    }
+  }
+  char name[40];
+  snprintf(name, sizeof(name), "%u baud, gauges lost", baud);
+  check(name, lost, "0", !lost);
+  snprintf(name, sizeof(name), "%u baud, strings failed", baud);
+  check(name, failed, "0", !failed);
+}
+
+static void timeout() {
+  GenieSimDisplay display;
+  Genie genie;
+  display.baud = 115200;
+  display.begin(115200);
+  genie.Begin(display);
+  for ( uint16_t value = 0; value < 200; value++ ) {
+    genie.WriteObject(GENIE_OBJ_GAUGE, value % 8, value);
+    run(genie, 5);
+  }
+  uint16_t ms = genie.GetAckTimeout();
+  check("115200 baud, ACK timeout ms", ms, "< GENIE_ACK_TIMEOUT", ms >= GENIE_ACK_TIMEOUT_MIN && ms < GENIE_ACK_TIMEOUT);
+}
+
+static void replay() {
+  GenieSimDisplay display;
+  Genie genie;
+  display.baud = 115200;
+  display.begin(115200);
+  genie.Begin(display);
+  run(genie, STARTUP_MS);
+
+  const uint8_t gauges = GENIE_SHADOW_SIZE - 1; /* and the fault LED */
+  genie.SetForm(2);
+  for ( uint8_t i = 0; i < gauges; i++ ) genie.WriteObject(GENIE_OBJ_GAUGE, i, 100 + i);
+  genie.WriteObject(GENIE_OBJ_USER_LED, 0, 1);
+  run(genie, 200);
+  display.connected = 0;
+  run(genie, 3500);
+  genie.WriteObject(GENIE_OBJ_USER_LED, 0, 0); /* written while offline */
+
+  display.form = 0; /* display reset, every widget cleared */
+  for ( uint8_t i = 0; i < gauges; i++ ) display.setValue(GENIE_OBJ_GAUGE, i, 0);
+  display.setValue(GENIE_OBJ_USER_LED, 0, 1);
+  display.connected = 1;
+  while ( !genie.IsOnline() ) genie.DoEvents();
+
+  uint64_t start = genie_host::now();
+  bool restored = 0;
+  while ( !restored && genie_host::now() - start < 1000000ULL ) {
+    genie.DoEvents();
+    restored = display.form == 2 && display.value(GENIE_OBJ_USER_LED, 0) == 0;
+    for ( uint8_t i = 0; restored && i < gauges; i++ ) restored = display.value(GENIE_OBJ_GAUGE, i) == 100 + i;
+  }
+  uint32_t ms = ( genie_host::now() - start ) / 1000;
+  check("form and widgets restored, ms", ms, "< 50", restored && ms < 50);
+}
+
+static void reset() {
+  GenieSimDisplay display;
+  Genie genie;
+  display.baud = 115200;
+  display.begin(115200);
+  genie.Begin(display);
+  run(genie, STARTUP_MS);
+
+  const uint8_t gauges = GENIE_SHADOW_SIZE - 1; /* and the fault LED */
+  genie.SetForm(2);
+  for ( uint8_t i = 0; i < gauges; i++ ) genie.WriteObject(GENIE_OBJ_GAUGE, i, 100 + i);
+  genie.WriteObject(GENIE_OBJ_USER_LED, 0, 1);
+  run(genie, 200);
+
+  display.form = 0; /* back on its first form, every widget cleared */
+  for ( uint8_t i = 0; i < gauges; i++ ) display.setValue(GENIE_OBJ_GAUGE, i, 0);
+  display.setValue(GENIE_OBJ_USER_LED, 0, 0);
+
+  uint64_t start = genie_host::now();
+  bool restored = 0;
+  while ( !restored && genie_host::now() - start < 5000000ULL ) {
+    genie.DoEvents();
+    for ( uint8_t i = 0; i < gauges; i++ ) genie.WriteObject(GENIE_OBJ_GAUGE, i, 100 + i); /* as a sketch writing every loop */
+    restored = display.value(GENIE_OBJ_USER_LED, 0) == 1;
+    for ( uint8_t i = 0; restored && i < gauges; i++ ) restored = display.value(GENIE_OBJ_GAUGE, i) == 100 + i;
+  }
+  uint32_t ms = ( genie_host::now() - start ) / 1000;
+  check("reset, widgets restored, ms", ms, "< 1500", restored && ms < 1500);
+}
+
+int main() {
+  printf("check\t\t\t\tmeasured\tlimit\tresult\n");
+  pings();
+  stream();
+  priority();
+  retries(9600);
+  retries(115200);
+  timeout();
+  replay();
+  reset();
+  printf("%u failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+// Per loop cost of running two displays from one controller, as an operator
+// and a supervisor display on ClearCore COM0 and COM1.
+//
+// Each loop writes a gauge on every link and calls DoEvents on every
+// instance, while each display reports a button press every EVENT_MS. One
+// event handler, attached with a context, serves both instances. Reports
+// the host CPU time per loop with one and with two links, the frames each
+// display acknowledged, and the events each handler context received, which
+// must match the presses on its own display only.
+//
+// Build from the library folder (see README.md in this folder):
+//    g++ -std=gnu++11 -O2 -Iextras/host -Isrc extras/host/MultiLinkBenchmark.cpp src/genieArduinoDEV.cpp -o multilink_bench
+
+#include "Arduino.h"
+#include "GenieSimDisplay.h"
+#include "genieArduinoDEV.h"
+#include <chrono>
+
+#define SECONDS   5
+#define WIDGETS   16
+#define EVENT_MS  20
+
+struct Link {
+  GenieSimDisplay display;
+  Genie genie;
+  uint32_t presses = 0; /* events the display sent */
+  uint32_t events = 0; /* events the handler received for this link */
+  uint32_t foreign = 0; /* events that reached this link's context from the other instance */
+};
+
+static void handler(Genie &genie, void *context) {
+  Link *link = (Link *)context;
+  genieFrame event;
+  genie.DequeueEvent(&event);
+  if ( &genie != &link->genie ) link->foreign++;
+  if ( event.reportObject.cmd == GENIE_REPORT_EVENT ) link->events++;
+}
+
+static void benchmark(uint8_t count, uint32_t baud) {
+  Link links[2];
+  for ( uint8_t i = 0; i < count; i++ ) {
+    links[i].display.baud = baud;
+    links[i].display.begin(baud);
+    if ( !links[i].genie.Begin(links[i].display) ) {
+      printf("%u\t%u\tdisplay %u not detected\n", count, baud, i);
+      return;
+    }
+    links[i].genie.AttachEventHandler(handler, &links[i]);
+  }
+
+  uint32_t acks[2] = { 0 }, loops = 0;
+  for ( uint8_t i = 0; i < count; i++ ) acks[i] = links[i].display.acks;
+  uint64_t start = genie_host::now(), next_event = start;
+  auto cpu_start = std::chrono::steady_clock::now();
+  for ( uint16_t value = 0; genie_host::now() - start < SECONDS * 1000000ULL; value++ ) {
+    if ( genie_host::now() >= next_event ) {
+      next_event += EVENT_MS * 1000;
+      for ( uint8_t i = 0; i < count; i++ ) {
+        links[i].display.event(GENIE_OBJ_4DBUTTON, i, value & 1);
+        links[i].presses++;
+      }
+    }
+    for ( uint8_t i = 0; i < count; i++ ) {
+      links[i].genie.WriteObject(GENIE_OBJ_GAUGE, value % WIDGETS, value);
+      links[i].genie.DoEvents();
+    }
+    loops++;
+  }
+  double cpu_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - cpu_start).count();
+  for ( uint16_t i = 0; i < 10000; i++ ) for ( uint8_t j = 0; j < count; j++ ) links[j].genie.DoEvents(); /* drain */
+
+  printf("%u\t%u\t%.0f", count, baud, cpu_ns / loops);
+  for ( uint8_t i = 0; i < count; i++ ) {
+    printf("\t\t%.0f fps, %u/%u events%s", (double)( links[i].display.acks - acks[i] ) / SECONDS,
+           links[i].events, links[i].presses, links[i].foreign ? ", CROSSED" : "");
+  }
+  printf("\n");
+}
+
+int main() {
+  const uint32_t bauds[] = { 9600, 115200 };
+  printf("links\tbaud\tns per loop\tper link\n");
+  for ( uint8_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++ ) {
+    benchmark(1, bauds[i]);
+    benchmark(2, bauds[i]);
+  }
+  return 0;
+}
@@ -57,15 +57,82 @@
 #define OCT 8
 #define BIN 2
 
+// number of payload bytes held in _outgoing_payload for a queued frame
+static uint16_t payload_length(const uint8_t *frame) {
+  switch ( frame[1] ) {
+    case GENIE_WRITE_STR:
+    case GENIE_WRITE_INH_LABEL:
+    case GENIEM_WRITE_BYTES:
+      return frame[3];
+    case GENIE_WRITE_STRU:
+    case GENIEM_WRITE_DBYTES:
+    case GENIE_WRITE_BATCH:
+      return 2 * frame[3];
+  }
+  return 0;
+}
+
+// widget writes, whose ACK comes back in a steady time, get the measured ACK timeout
+static bool ack_adaptive(const uint8_t *frame) {
+  return frame[1] == GENIE_WRITE_OBJ && frame[2] != GENIE_OBJ_FORM;
+}
+
+// widgets whose written value is a persistent state, so a repeated write is redundant.
+// Forms, momentary buttons, keyboards and widgets where each write is an action are excluded.
+static bool shadow_enabled(uint8_t object) {
+  switch ( object ) {
+    case GENIE_OBJ_FORM:
+    case GENIE_OBJ_WINBUTTON:
+    case GENIE_OBJ_4DBUTTON:
+    case GENIE_OBJ_USERBUTTON:
+    case GENIE_OBJ_ANIBUTTON:
+    case GENIE_OBJ_IBUTTOND:
+    case GENIE_OBJ_IBUTTONE:
+    case GENIE_OBJ_IMEDIA_BUTTON:
+    case GENIE_OBJ_KEYBOARD:
+    case GENIE_OBJ_STRINGS:
+    case GENIE_OBJ_ILABELB:
+    case GENIE_OBJ_SCOPE:
+    case GENIE_OBJ_COOL_GAUGE:
+    case GENIE_OBJ_SPECTRUM:
+    case GENIE_OBJ_SOUND:
+    case GENIE_OBJ_TIMER:
+    case GENIE_OBJ_MAGICOBJECT:
+      return 0;
+  }
+  return 1;
+}
 
 // ######################################
 // ## GENIE CLASS ####################### 
 // ######################################
 Genie::Genie() {
   UserHandler = nullptr;
+  UserContextHandler = nullptr;
+  handler_context = nullptr;
+  UserConnectionHandler = nullptr;
+  UserConnectionContextHandler = nullptr;
+  connection_context = nullptr;
   UserByteReader = nullptr;
+  UserByteContextReader = nullptr;
+  byte_context = nullptr;
   UserDoubleByteReader = nullptr;
+  UserDoubleByteContextReader = nullptr;
+  dbyte_context = nullptr;
+  UserMagicReceiver = nullptr;
+  UserMagicContextReceiver = nullptr;
+  magic_context = nullptr;
+  magic_buffer = nullptr;
+  magic_buffer_size = 0;
   debugSerial = nullptr;
+  memset(event_append, 0, sizeof(event_append));
+  static const uint8_t lossless[] = { GENIE_OBJ_KEYBOARD, GENIE_OBJ_WINBUTTON, GENIE_OBJ_4DBUTTON, GENIE_OBJ_USERBUTTON, GENIE_OBJ_ANIBUTTON,
+                                      GENIE_OBJ_IBUTTOND, GENIE_OBJ_IBUTTONE, GENIE_OBJ_IMEDIA_BUTTON };
+  for ( uint8_t i = 0; i < sizeof(lossless); i++ ) SetEventPolicy(lossless[i], GENIE_EVENT_APPEND);
+  memset(write_high, 0, sizeof(write_high));
+  static const uint8_t state[] = { GENIE_OBJ_FORM, GENIE_OBJ_LED, GENIE_OBJ_USER_LED };
+  for ( uint8_t i = 0; i < sizeof(state); i++ ) SetWritePriority(state[i], GENIE_PRIORITY_HIGH);
+  memset(read_mirror, 0, sizeof(read_mirror));
 }
 
 // ######################################
@@ -74,13 +141,39 @@ Genie::Genie() {
 bool Genie::Begin(HardwareSerial &serial) {
   deviceSerial = &serial;
   tx_delay = 0;
+  baud_rate = 0;
   return Begin_common();
 }
 
+// Opens the port at each candidate rate in turn and keeps the first one the
+// display answers the form ping on. The port is left at bauds[0] if none does.
+bool Genie::Begin(HardwareSerial &serial, const uint32_t *bauds, uint8_t count) {
+  deviceSerial = &serial;
+  tx_delay = 0;
+  baud_rate = 0;
+  for ( uint8_t i = 0; i < count; i++ ) {
+    serial.begin(bauds[i]);
+    while ( serial.available() ) serial.read(); /* anything received at the previous rate is garbage */
+    rx_count = 0;
+    if ( Begin_common(GENIE_BAUD_PROBE_TIME, 0) ) {
+      baud_rate = bauds[i];
+      if ( debug_enabled(GENIE_LOG_INFO) ) {
+        debugSerial->print(F("[Genie]: Display found at "));
+        debugSerial->print(baud_rate);
+        debugSerial->println(F(" baud"));
+      }
+      return 1;
+    }
+  }
+  if ( count ) serial.begin(bauds[0]);
+  return Begin_common(0);
+}
+
 #if GENIE_SS_SUPPORT
 	bool Genie::Begin(SoftwareSerial &serial) {
 	  deviceSerial = &serial;
 	  tx_delay = 1000;
+	  baud_rate = 0;
 	  return Begin_common();
 	}
 #endif
@@ -88,20 +181,80 @@ bool Genie::Begin(HardwareSerial &serial) {
 bool Genie::Begin(Stream &serial, uint16_t txDelay) {
   deviceSerial = &serial;
   tx_delay = txDelay;
+  baud_rate = 0;
   return Begin_common();
 }
 
-bool Genie::Begin_common() {
+// Returns at once, DoEvents() finds the display in the background. Attach a
+// connection handler to learn when it comes online.
+void Genie::BeginAsync(HardwareSerial &serial) {
+  deviceSerial = &serial;
+  tx_delay = 0;
+  baud_rate = 0;
+  begin_reset();
+}
+
+// As Begin(serial, bauds, count), with DoEvents() moving to the next rate every
+// GENIE_BAUD_PROBE_TIME ms until the display answers. bauds must stay valid.
+void Genie::BeginAsync(HardwareSerial &serial, const uint32_t *bauds, uint8_t count) {
+  deviceSerial = &serial;
+  tx_delay = 0;
+  baud_rate = 0;
+  begin_reset();
+  if ( !count ) return;
+  probe_serial = &serial;
+  probe_bauds = bauds;
+  probe_count = count;
+  probe_index = count - 1;
+  probe_next(); /* starts at bauds[0] */
+}
+
+#if GENIE_SS_SUPPORT
+	void Genie::BeginAsync(SoftwareSerial &serial) {
+	  deviceSerial = &serial;
+	  tx_delay = 1000;
+	  baud_rate = 0;
+	  begin_reset();
+	}
+#endif
+
+void Genie::BeginAsync(Stream &serial, uint16_t txDelay) {
+  deviceSerial = &serial;
+  tx_delay = txDelay;
+  baud_rate = 0;
+  begin_reset();
+}
+
+void Genie::begin_reset() {
   genieStart = 1;
+  tx_abort(); /* frame cut short by a new Begin */
+  tx_buffered = !tx_delay && deviceSerial->availableForWrite() > 0;
+  displayDetected = 0; /* detect again, Begin may be called more than once */
+  probe_serial = nullptr;
   _incomming_queue.clear();
+  shadow_invalidate();
+}
+
+void Genie::probe_next() {
+  if ( ++probe_index >= probe_count ) probe_index = 0;
+  probe_serial->begin(probe_bauds[probe_index]);
+  while ( probe_serial->available() ) probe_serial->read(); /* anything received at the previous rate is garbage */
+  rx_count = 0;
+  probe_since = millis();
+  autoPingTimer = probe_since - recover_pulse - 1; /* ping at the new rate right away */
+}
+
+bool Genie::Begin_common(uint16_t timeout, bool report) {
+  begin_reset();
   uint32_t timeout_start = millis(); // timeout timer
-  while ( millis() - timeout_start <= 2000 ) { 
+  while ( millis() - timeout_start <= timeout ) { 
     if ( DoEvents() == GENIE_REPORT_OBJ && !genieStart ) return 1;
   }
-  if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: Failed to detect display during setup"));
-  if ( UserHandler ) {
+  if ( !report ) return 0; /* still probing */
+  if ( debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: Failed to detect display during setup"));
+  if ( handler_attached() ) {
     uint8_t buffer[6] = { GENIE_DISCONNECTED, 0, 0, 0, 0 };
-    _incomming_queue.push_back(buffer, 6);
+    queue_event(buffer);
   }
   displayDetected = 0;
   return 0;
@@ -127,30 +280,226 @@ void Genie::SetRecoveryInterval(uint8_t pulses) {
   recover_pulse = pulses;
 }
 
+// Pings the display after idle ms without a valid frame from it, and reports it
+// disconnected after timeout ms. Any frame counts, so a busy link is never pinged.
+void Genie::SetLinkTimeouts(uint16_t idle, uint16_t timeout) {
+  ping_idle = idle;
+  display_timeout = timeout;
+}
+
 // ######################################
 // ## AttachEventHandler ################ 
 // ######################################
 
+// Called from DoEvents() with the new state whenever the display comes online
+// or goes offline, outside the receive parser so it may write to the display.
+void Genie::AttachConnectionHandler(UserConnectionPtr userHandler) {
+  UserConnectionHandler = userHandler;
+  UserConnectionContextHandler = nullptr;
+}
+
+// As above, with the instance and context passed to the handler, for one
+// handler serving several displays.
+void Genie::AttachConnectionHandler(UserConnectionContextPtr userHandler, void *context) {
+  UserConnectionHandler = nullptr;
+  UserConnectionContextHandler = userHandler;
+  connection_context = context;
+}
+
 void Genie::AttachEventHandler(UserEventHandlerPtr userHandler) {
   UserHandler = userHandler;
+  UserContextHandler = nullptr;
+  handler_setup();
+}
+
+// As above, called as userHandler(*this, context). Lets one handler serve
+// several Genie instances, each on its own serial port.
+void Genie::AttachEventHandler(UserEventContextPtr userHandler, void *context) {
+  UserHandler = nullptr;
+  UserContextHandler = userHandler;
+  handler_context = context;
+  handler_setup();
+}
+
+void Genie::handler_setup() {
   if ( !displayDetected ) {
-    if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: Handler setup, display disconnected"));
+    if ( debug_enabled(GENIE_LOG_INFO) ) debugSerial->println(F("[Genie]: Handler setup, display disconnected"));
     uint8_t buffer[6] = { GENIE_DISCONNECTED, 0, 0, 0, 0 };
-    _incomming_queue.push_back(buffer, 6);
+    queue_event(buffer);
   }
   else {
-    if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: Handler setup, display online"));
+    if ( debug_enabled(GENIE_LOG_INFO) ) debugSerial->println(F("[Genie]: Handler setup, display online"));
     uint8_t buffer[6] = { GENIE_READY, 0, 0, 0, 0 };
-    _incomming_queue.push_back(buffer, 6);
+    queue_event(buffer);
   }
 }
 
+// ######################################
+// ## Event Policy ######################
+// ######################################
+
+void Genie::SetEventPolicy(uint8_t object, uint8_t policy) {
+  if ( object > GENIE_OBJ_ILINEAR_INPUT ) return;
+  if ( policy == GENIE_EVENT_APPEND ) event_append[object >> 3] |= 1 << (object & 7);
+  else event_append[object >> 3] &= ~(1 << (object & 7));
+}
+
+uint8_t Genie::GetEventPolicy(uint8_t object) {
+  if ( object > GENIE_OBJ_ILINEAR_INPUT ) return GENIE_EVENT_COALESCE;
+  return ( event_append[object >> 3] >> (object & 7) ) & 1;
+}
+
+// ######################################
+// ## Write Priority ####################
+// ######################################
+
+void Genie::SetWritePriority(uint8_t object, uint8_t priority) {
+  if ( object > GENIE_OBJ_ILINEAR_INPUT ) return;
+  if ( priority == GENIE_PRIORITY_HIGH ) write_high[object >> 3] |= 1 << (object & 7);
+  else write_high[object >> 3] &= ~(1 << (object & 7));
+}
+
+uint8_t Genie::GetWritePriority(uint8_t object) {
+  if ( object > GENIE_OBJ_ILINEAR_INPUT ) return GENIE_PRIORITY_LOW;
+  return ( write_high[object >> 3] >> (object & 7) ) & 1;
+}
+
+// ######################################
+// ## Read Policy #######################
+// ######################################
+
+void Genie::SetReadPolicy(uint8_t object, uint8_t policy) {
+  if ( object > GENIE_OBJ_ILINEAR_INPUT ) return;
+  if ( policy == GENIE_READ_MIRROR ) read_mirror[object >> 3] |= 1 << (object & 7);
+  else read_mirror[object >> 3] &= ~(1 << (object & 7));
+}
+
+uint8_t Genie::GetReadPolicy(uint8_t object) {
+  if ( object > GENIE_OBJ_ILINEAR_INPUT ) return GENIE_READ_DISPLAY;
+  return ( read_mirror[object >> 3] >> (object & 7) ) & 1;
+}
+
+// Queues a received frame for the user handler. A coalescing event replaces the one
+// queued for the same widget, and never takes one of the last GENIE_EVENT_RESERVE
+// slots: past that it pushes out the oldest coalescing event, so the newest report
+// is the one kept. Anything else is appended, pushing out the oldest coalescing
+// event if the queue is full.
+void Genie::queue_event(uint8_t *frame) {
+  if ( frame[0] == GENIE_REPORT_EVENT && GetEventPolicy(frame[1]) == GENIE_EVENT_COALESCE ) {
+    if ( _incomming_queue.replace<0,1,2>(frame,6) ) return;
+    if ( _incomming_queue.capacity() - _incomming_queue.size() > GENIE_EVENT_RESERVE ) {
+      _incomming_queue.push_back(frame, 6);
+      return;
+    }
+    if ( event_evict() ) _incomming_queue.push_back(frame, 6); /* an older report is the one lost */
+  }
+  else {
+    if ( _incomming_queue.size() < _incomming_queue.capacity() ) {
+      _incomming_queue.push_back(frame, 6);
+      return;
+    }
+    event_evict();
+    _incomming_queue.push_back(frame, 6); /* overwrites the oldest event when still full */
+  }
+  link_stats.events_dropped++;
+  if ( debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: Event queue full, event dropped"));
+}
+
+/* removes the oldest queued coalescing event, 0 if there is none */
+bool Genie::event_evict() {
+  uint8_t queued[6];
+  for ( uint16_t i = 0; i < _incomming_queue.size(); i++ ) {
+    _incomming_queue.peek_front(queued, 6, i);
+    if ( queued[0] == GENIE_REPORT_EVENT && GetEventPolicy(queued[1]) == GENIE_EVENT_COALESCE ) return _incomming_queue.findRemove<0,1,2>(queued,6);
+  }
+  return 0;
+}
+
+#if GENIE_MAGIC_SUPPORT
 void Genie::AttachMagicByteReader(UserBytePtr userHandler) {
   UserByteReader = userHandler;
+  UserByteContextReader = nullptr;
+}
+
+// The context overloads below call their handler with the instance and context,
+// as AttachEventHandler(userHandler, context) does.
+void Genie::AttachMagicByteReader(UserByteContextPtr userHandler, void *context) {
+  UserByteReader = nullptr;
+  UserByteContextReader = userHandler;
+  byte_context = context;
 }
 
 void Genie::AttachMagicDoubleByteReader(UserDoubleBytePtr userHandler) {
   UserDoubleByteReader = userHandler;
+  UserDoubleByteContextReader = nullptr;
+}
+
+void Genie::AttachMagicDoubleByteReader(UserDoubleByteContextPtr userHandler, void *context) {
+  UserDoubleByteReader = nullptr;
+  UserDoubleByteContextReader = userHandler;
+  dbyte_context = context;
+}
+
+void Genie::AttachMagicReceiver(uint8_t *buffer, uint16_t size, UserMagicPtr userHandler) {
+  magic_attach(( userHandler != nullptr ) ? buffer : nullptr, size);
+  UserMagicReceiver = ( magic_buffer != nullptr ) ? userHandler : nullptr;
+  UserMagicContextReceiver = nullptr;
+}
+
+void Genie::AttachMagicReceiver(uint8_t *buffer, uint16_t size, UserMagicContextPtr userHandler, void *context) {
+  magic_attach(( userHandler != nullptr ) ? buffer : nullptr, size);
+  UserMagicReceiver = nullptr;
+  UserMagicContextReceiver = ( magic_buffer != nullptr ) ? userHandler : nullptr;
+  magic_context = context;
+}
+
+void Genie::magic_attach(uint8_t *buffer, uint16_t size) {
+  if ( rx_count && ( rx_frame[0] == GENIEM_REPORT_BYTES || rx_frame[0] == GENIEM_REPORT_DBYTES ) ) rx_count = 0; /* report half in the old buffer */
+  magic_buffer = buffer;
+  magic_buffer_size = ( magic_buffer != nullptr ) ? size : 0;
+}
+#endif
+
+uint32_t Genie::GetBaudRate() {
+  return baud_rate;
+}
+
+const GenieLinkStats& Genie::GetLinkStats() {
+  return link_stats;
+}
+
+void Genie::ResetLinkStats() {
+  link_stats = GenieLinkStats();
+}
+
+// ms a widget write currently waits for its ACK before it is sent again
+uint16_t Genie::GetAckTimeout() {
+  return ack_timeout;
+}
+
+// Round trip estimate as TCP keeps it: smoothed mean plus four deviations.
+void Genie::ack_measure(uint32_t us) {
+  if ( !ack_srtt ) {
+    ack_srtt = us;
+    ack_rttvar = us / 2;
+  }
+  else {
+    int32_t err = (int32_t)us - (int32_t)ack_srtt;
+    ack_srtt += err / 8;
+    ack_rttvar += ( ( err < 0 ? -err : err ) - (int32_t)ack_rttvar ) / 4;
+  }
+  uint32_t timeout = ( ack_srtt + 4 * ack_rttvar ) / 1000 + 1;
+  ack_timeout = ( timeout < GENIE_ACK_TIMEOUT_MIN ) ? GENIE_ACK_TIMEOUT_MIN : ( timeout > GENIE_ACK_TIMEOUT ) ? GENIE_ACK_TIMEOUT : timeout;
+}
+
+void Genie::link_record(GenieLatencyStats &stats, uint32_t us) {
+  if ( !stats.count || us < stats.min ) stats.min = us;
+  if ( us > stats.max ) stats.max = us;
+  stats.count++;
+  stats.total += us;
+  uint8_t bucket = 0;
+  for ( uint32_t edge = 256; us >= edge && bucket < GENIE_LATENCY_BUCKETS - 1; edge <<= 1 ) bucket++;
+  if ( stats.histogram[bucket] < 0xFFFF ) stats.histogram[bucket]++;
 }
 
 uint32_t Genie::GetUptime() {
@@ -158,66 +507,315 @@ uint32_t Genie::GetUptime() {
   else return 0;
 }
 
+// ######################################
+// ## Write Status ######################
+// ######################################
+uint8_t Genie::GetWriteStatus(uint16_t ticket) {
+  if ( ticket == GENIE_TICKET_UNCHANGED ) return GENIE_TX_ACKED;
+  uint8_t slot = ticket & (GENIE_TX_TRACKED - 1);
+  if ( !ticket || tx_status_ticket[slot] != ticket ) return GENIE_TX_UNKNOWN;
+  return tx_status[slot];
+}
+
+void Genie::set_write_status(uint16_t ticket, uint8_t status) {
+  if ( !ticket ) return;
+  uint8_t slot = ticket & (GENIE_TX_TRACKED - 1);
+  if ( status == GENIE_TX_QUEUED ) tx_status_ticket[slot] = ticket; /* new tickets claim the slot */
+  else if ( tx_status_ticket[slot] != ticket ) return; /* slot reused by a newer ticket */
+  tx_status[slot] = status;
+}
+
+// ######################################
+// ## Widget Shadow #####################
+// ######################################
+// With create set, a widget not in the table takes a free entry, else the least
+// recently updated entry that only holds a reported value. Entries the sketch wrote
+// are kept for shadow_replay().
+GenieShadowEntry* Genie::shadow_find(uint8_t object, uint8_t index, bool create) {
+  uint8_t slot = ((object * 31) ^ index) & (GENIE_SHADOW_SIZE - 1);
+  GenieShadowEntry *claim = nullptr;
+  uint32_t now = millis();
+  for ( uint8_t i = 0; i < GENIE_SHADOW_SIZE; i++, slot = (slot + 1) & (GENIE_SHADOW_SIZE - 1) ) {
+    GenieShadowEntry &entry = shadow[slot];
+    if ( !entry.used ) {
+      claim = &entry;
+      break;
+    }
+    if ( entry.object == object && entry.index == index ) return &entry;
+    if ( create && !entry.wrote && !entry.batch && ( claim == nullptr || now - entry.updated > now - claim->updated ) ) claim = &entry;
+  }
+  if ( !create ) return nullptr;
+  if ( claim == nullptr ) { /* table full of written widgets, this one is not shadowed */
+    if ( !shadow_full_logged && debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: Shadow table full, raise GENIE_SHADOW_SIZE"));
+    shadow_full_logged = 1;
+    return nullptr;
+  }
+  claim->used = 1;
+  claim->valid = 0;
+  claim->wrote = 0;
+  claim->updated = 0;
+  claim->object = object;
+  claim->index = index;
+  return claim;
+}
+
+void Genie::shadow_store(uint8_t object, uint8_t index, uint16_t value) {
+  if ( !shadow_enabled(object) ) return;
+  GenieShadowEntry *entry = shadow_find(object, index, 1);
+  if ( entry == nullptr || entry->batch ) return; /* a batch queued later carries a newer value */
+  entry->value = value;
+  entry->valid = 1;
+  entry->updated = millis();
+}
+
+// A value the display reported. event is set for a change made on the touch
+// screen, which then also becomes the value restored after a reconnect.
+void Genie::shadow_report(uint8_t object, uint8_t index, uint16_t value, bool event) {
+  if ( !shadow_enabled(object) ) return;
+  GenieShadowEntry *entry = shadow_find(object, index, GetReadPolicy(object) == GENIE_READ_MIRROR); /* else only widgets we have written are tracked */
+  if ( entry == nullptr ) return;
+  entry->value = value;
+  entry->valid = 1;
+  entry->updated = millis();
+  if ( event && entry->wrote ) entry->written = value;
+}
+
+// true if the display shows, or is about to be sent, this value and no other write is queued for the widget
+bool Genie::shadow_redundant(uint8_t object, uint8_t index, uint16_t value) {
+  if ( !shadow_enabled(object) ) return 0;
+  uint8_t queued[7] = { 0, GENIE_WRITE_OBJ, object, index, 0, 0, 0 };
+  if ( _outgoing_priority.find<1,2,3>(queued,7) || _outgoing_queue.find<1,2,3>(queued,7) ) return 0; /* the queued write gets replaced instead */
+  GenieShadowEntry *entry = shadow_find(object, index);
+  if ( entry != nullptr && entry->batch ) return entry->value == value; /* newest value is in a queued batch */
+  if ( tx_inflight_write && tx_inflight_object == object && tx_inflight_index == index ) return tx_inflight_value == value;
+  return entry != nullptr && entry->valid && entry->value == value;
+}
+
+// Keeps the last value the sketch wrote to each widget, and the form it chose, so
+// shadow_replay() can restore them on a display that comes back.
+void Genie::shadow_mirror(uint8_t object, uint8_t index, uint16_t value) {
+  if ( object == GENIE_OBJ_FORM ) replay_form = index;
+  if ( !shadow_enabled(object) ) return;
+  GenieShadowEntry *entry = shadow_find(object, index, 1);
+  if ( entry == nullptr ) return;
+  entry->written = value;
+  entry->wrote = 1;
+}
+
+// Queues the mirrored values the display does not show yet after a reconnect, object
+// types set to GENIE_PRIORITY_HIGH first. A few at a time, so the queues never overflow
+// and new writes from the sketch still get through.
+void Genie::shadow_replay() {
+  while ( replay_pos < 2 * GENIE_SHADOW_SIZE && displayDetected ) {
+    GenieShadowEntry &entry = shadow[replay_pos & (GENIE_SHADOW_SIZE - 1)];
+    bool high = ( replay_pos < GENIE_SHADOW_SIZE );
+    if ( entry.used && entry.wrote && ( GetWritePriority(entry.object) == GENIE_PRIORITY_HIGH ) == high && !shadow_redundant(entry.object, entry.index, entry.written) ) {
+      if ( high ? _outgoing_priority.size() >= _outgoing_priority.capacity() / 2 : _outgoing_queue.size() >= _outgoing_queue.capacity() / 2 ) return;
+      queue_write(entry.object, entry.index, entry.written, GENIE_WRITE_OBJ ^ entry.object ^ entry.index);
+    }
+    replay_pos++;
+  }
+}
+
+void Genie::shadow_forget(uint8_t object, uint8_t index) {
+  GenieShadowEntry *entry = shadow_find(object, index);
+  if ( entry != nullptr ) entry->valid = 0;
+}
+
+void Genie::shadow_invalidate() {
+  for ( uint8_t i = 0; i < GENIE_SHADOW_SIZE; i++ ) {
+    shadow[i].valid = 0;
+    shadow[i].batch = 0;
+  }
+  tx_inflight_write = 0;
+}
+
+// the batch frame with this ticket was answered or dropped
+void Genie::shadow_settle(uint16_t ticket, bool acked) {
+  if ( !ticket ) return;
+  for ( uint8_t i = 0; i < GENIE_SHADOW_SIZE; i++ ) {
+    if ( shadow[i].batch != ticket ) continue;
+    shadow[i].batch = 0;
+    shadow[i].valid = acked;
+    shadow[i].updated = millis();
+  }
+}
+
+#if GENIE_MAGIC_SUPPORT
 // ######################################
 // ## GetNextByte ####################### 
 // ######################################
 int16_t Genie::GetNextByte() {
-  if ( magic_report_len-- < 1 ) {
-    magic_report_len = 0;
+  if ( magic_report_len < 1 ) {
     magic_overpull_count++;
     return -1;
   }
-  uint32_t timeout = millis();
-  while ( millis() - timeout < 100 && deviceSerial->available() < 1 );
-  return deviceSerial->read();
+  magic_report_len--;
+#if GENIE_MAGIC_BUFFER_SIZE
+  return _incomming_magic.read();
+#else
+  return -1; /* never reached, magic_report_len stays 0 without the buffer */
+#endif
 }
 
 // ######################################
 // ## GetNextDoubleByte ################# 
 // ######################################
 int32_t Genie::GetNextDoubleByte() {
-  // protection to be implemented
-  uint32_t timeout = millis();
-  while ( millis() - timeout < 200 && deviceSerial->available() < 2 );
-  return ((uint16_t)(deviceSerial->read() << 8) | deviceSerial->read());
+  int16_t msb = GetNextByte();
+  int16_t lsb = GetNextByte();
+  if ( msb < 0 || lsb < 0 ) return -1;
+  return ((uint16_t)msb << 8) | lsb;
 }
+#endif
 
 // ######################################
 // ## Read Object ####################### 
 // ######################################
 int32_t Genie::ReadObject(uint8_t object, uint8_t index, bool now) {
   if ( !displayDetected ) {
-    DoEvents();
+    poll_events();
     return -1;
   }
-  DoEvents();
+  poll_events();
+  if ( now && displayDetected && GetReadPolicy(object) == GENIE_READ_MIRROR ) {
+    GenieShadowEntry *entry = shadow_find(object, index);
+    if ( entry != nullptr && entry->valid ) return entry->value;
+  }
   uint8_t checksum = 0, buffer[5] = { (uint8_t)currentForm, (uint8_t)GENIE_READ_OBJ, object, index, 0 };
   for ( uint8_t i = 1; i < 4; i++ ) checksum ^= buffer[i];
   buffer[4] = checksum;
-  if ( now && displayDetected ) {
-    block_dequeue = 1; // disable dequeueing
-    while ( pendingACK ) DoEvents(); // wait & finish pending ACKs
-    handler_response_request = 1; // request widget value immediately
-    handler_response_values[1] = object;
-    handler_response_values[2] = index;
-    writeMode(&buffer[1],4);
-    block_dequeue = 0; // enable dequeueing
-    uint32_t timeout = millis();
-    while ( handler_response_request ) {
-      if ( millis() - timeout > 100 ) {
-        handler_response_request = 0;
-        return -1;
-      }
-      DoEvents();
+  if ( now && displayDetected ) return read_display(object, index);
+  if ( !_outgoing_queue.replace<1,2,3>(buffer,5) ) enqueue_frame(buffer,5);
+  if ( now && !displayDetected ) return -1;
+  return 1;
+}
+
+// Asks the display even for a GENIE_READ_MIRROR object type. The answer
+// updates the mirror.
+int32_t Genie::RefreshObject(uint8_t object, uint8_t index) {
+  poll_events();
+  if ( !displayDetected ) return -1;
+  return read_display(object, index);
+}
+
+// millis() when the mirrored value of a widget was last reported by the
+// display or acknowledged for a write, 0 if it is not known.
+uint32_t Genie::GetMirrorTime(uint8_t object, uint8_t index) {
+  GenieShadowEntry *entry = shadow_find(object, index);
+  return ( entry != nullptr && entry->valid ) ? entry->updated : 0;
+}
+
+// Sends a GENIE_READ_OBJ right away and waits up to 100ms for the report.
+int32_t Genie::read_display(uint8_t object, uint8_t index) {
+  uint8_t buffer[4] = { (uint8_t)GENIE_READ_OBJ, object, index, (uint8_t)(GENIE_READ_OBJ ^ object ^ index) };
+  block_dequeue = 1; // disable dequeueing
+  while ( pendingACK || tx_stream_left ) DoEvents(); // wait & finish pending ACKs
+  handler_response_request = 1; // request widget value immediately
+  handler_response_values[1] = object;
+  handler_response_values[2] = index;
+  writeMode(buffer,4);
+  block_dequeue = 0; // enable dequeueing
+  uint32_t timeout = millis();
+  while ( handler_response_request ) {
+    if ( millis() - timeout > 100 ) {
+      handler_response_request = 0;
+      return -1;
     }
-    return ((int32_t)(handler_response_values[3] << 8) | handler_response_values[4]);
+    DoEvents();
+  }
+  return ((int32_t)(handler_response_values[3] << 8) | handler_response_values[4]);
+}
+
+uint16_t Genie::ReadObjectAsync(uint8_t object, uint8_t index, UserReadPtr callback) {
+  return read_start(object, index, callback, nullptr, nullptr);
+}
+
+// As above, with the instance and context passed to the callback.
+uint16_t Genie::ReadObjectAsync(uint8_t object, uint8_t index, UserReadContextPtr callback, void *context) {
+  return read_start(object, index, nullptr, callback, context);
+}
+
+uint16_t Genie::read_start(uint8_t object, uint8_t index, UserReadPtr callback, UserReadContextPtr context_callback, void *context) {
+  if ( !displayDetected ) {
+    poll_events();
+    return 0;
   }
-  if ( !_outgoing_queue.replace(buffer,5,1,2,3) ) {
-    if ( _outgoing_queue.size() == _outgoing_queue.capacity() ) if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: Overflow writing frames to queue!"));
-    _outgoing_queue.push_back(buffer,5);
+  poll_events();
+  GenieReadRequest *slot = nullptr;
+  for ( uint8_t i = 0; i < GENIE_READS_TRACKED; i++ ) { /* reuse a free slot, else the oldest finished request */
+    if ( reads[i].status == GENIE_TX_QUEUED || reads[i].status == GENIE_TX_SENT ) continue;
+    if ( !reads[i].handle ) { slot = &reads[i]; break; }
+    if ( !slot || (uint16_t)(read_handle_counter - reads[i].handle) > (uint16_t)(read_handle_counter - slot->handle) ) slot = &reads[i];
+  }
+  if ( slot == nullptr ) {
+    if ( debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: Too many reads outstanding, raise GENIE_READS_TRACKED"));
+    return 0;
+  }
+  if ( !++read_handle_counter ) ++read_handle_counter; /* handle 0 is reserved for failures */
+  slot->handle = read_handle_counter;
+  slot->object = object;
+  slot->index = index;
+  slot->status = GENIE_TX_QUEUED;
+  slot->notify = 0;
+  slot->callback = callback;
+  slot->context_callback = context_callback;
+  slot->context = context;
+  uint8_t buffer[5] = { (uint8_t)currentForm, (uint8_t)GENIE_READ_OBJ, object, index, 0 };
+  buffer[4] = buffer[1] ^ object ^ index;
+  if ( !_outgoing_queue.replace<1,2,3>(buffer,5) ) enqueue_frame(buffer,5); /* one frame answers every request for the widget */
+  return slot->handle;
+}
+
+uint8_t Genie::GetReadStatus(uint16_t handle) {
+  GenieReadRequest *r = read_find(handle);
+  return ( r != nullptr ) ? r->status : GENIE_TX_UNKNOWN;
+}
+
+int32_t Genie::GetReadValue(uint16_t handle) {
+  GenieReadRequest *r = read_find(handle);
+  if ( r == nullptr || r->status != GENIE_TX_ACKED ) return -1;
+  return r->value;
+}
+
+GenieReadRequest* Genie::read_find(uint16_t handle) {
+  if ( !handle ) return nullptr;
+  for ( uint8_t i = 0; i < GENIE_READS_TRACKED; i++ ) if ( reads[i].handle == handle ) return &reads[i];
+  return nullptr;
+}
+
+// Finishes the requests waiting on object/index: a report (GENIE_TX_ACKED) answers
+// the sent ones, a dropped frame (GENIE_TX_DROPPED) the queued ones.
+// Callbacks run later from DoEvents, see read_service().
+bool Genie::read_finish(uint8_t object, uint8_t index, uint8_t status, uint16_t value) {
+  bool found = 0;
+  for ( uint8_t i = 0; i < GENIE_READS_TRACKED; i++ ) {
+    GenieReadRequest &r = reads[i];
+    if ( r.object != object || r.index != index ) continue;
+    if ( r.status != (( status == GENIE_TX_ACKED ) ? GENIE_TX_SENT : GENIE_TX_QUEUED) ) continue;
+    r.status = status;
+    r.value = value;
+    r.notify = 1;
+    found = 1;
+  }
+  return found;
+}
+
+// Times out sent requests and runs the callbacks of finished ones.
+void Genie::read_service() {
+  uint32_t now = millis();
+  for ( uint8_t i = 0; i < GENIE_READS_TRACKED; i++ ) {
+    GenieReadRequest &r = reads[i];
+    if ( r.status == GENIE_TX_SENT && now - r.sent > GENIE_READ_TIMEOUT ) {
+      r.status = GENIE_TX_TIMEOUT;
+      r.notify = 1;
+    }
+    if ( !r.notify ) continue;
+    r.notify = 0;
+    int32_t value = ( r.status == GENIE_TX_ACKED ) ? (int32_t)r.value : -1;
+    if ( r.context_callback != nullptr ) r.context_callback(*this, r.object, r.index, value, r.context);
+    else if ( r.callback != nullptr ) r.callback(r.object, r.index, value);
   }
-  if ( now && !displayDetected ) return -1;
-  return 1;
 }
 
 // ######################################
@@ -246,59 +844,45 @@ uint16_t Genie::WriteIntLedDigits(uint16_t index, int32_t data) {
 // ## Write Object ######################
 // ######################################
 bool Genie::WriteObject(uint8_t object, uint8_t index, uint16_t data) {
+  return write_object(object, index, data, GENIE_WRITE_OBJ ^ object ^ index);
+}
+
+// header_crc is the XOR of cmd, object and index, a constant for GenieStaticObject.
+bool Genie::write_object(uint8_t object, uint8_t index, uint16_t data, uint8_t header_crc) {
+  shadow_mirror(object, index, data); /* replayed after a reconnect, also when written offline */
   if ( !displayDetected ) {
-    DoEvents();
+    poll_events();
     return 0;
   }
-  DoEvents();
+  poll_events();
 
-  if ( main_handler_active ) {
-    if ( GENIE_OBJ_FORM == object ) currentForm = index;
-    return WriteObjectPriority(object,index,data);
-  }
-
-  uint8_t checksum = 0, buffer[7] = { (uint8_t)currentForm, GENIE_WRITE_OBJ, object, index, (uint8_t)(data >> 8), (uint8_t)data, 0 };
-  for ( uint8_t i = 1; i < 6; i++ ) checksum ^= buffer[i];
-  buffer[6] = checksum;
-
-  if ( object == GENIE_OBJ_SCOPE ) return WriteObjectPriority(object,index,data);
-  if ( object == GENIE_OBJ_COOL_GAUGE ) return WriteObjectPriority(object,index,data);
-  if ( !_outgoing_queue.replace(buffer,7,1,2,3) ) {
-    if ( _outgoing_queue.size() == _outgoing_queue.capacity() ) if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: Overflow writing frames to queue!"));
-
-    if ( GENIE_OBJ_FORM == object ) {
-      WriteObjectPriority(object, index, data); /* write the form to display immediately */
-      currentForm = index; /* update the local form state immediately */
-    }
-    else _outgoing_queue.push_back(buffer,7); /* queue normal objects */
-  }
+  if ( shadow_redundant(object, index, data) ) return 1; /* display already shows it, or it is on its way */
+  queue_write(object, index, data, header_crc);
   return 1;
 }
 
+void Genie::queue_write(uint8_t object, uint8_t index, uint16_t data, uint8_t header_crc) {
+  uint8_t buffer[7] = { (uint8_t)currentForm, GENIE_WRITE_OBJ, object, index, (uint8_t)(data >> 8), (uint8_t)data, 0 };
+  buffer[6] = header_crc ^ buffer[4] ^ buffer[5];
 
-// ######################################
-// ## Write Object Priority Task ########
-// ######################################
-
-bool Genie::WriteObjectPriority(uint8_t object, uint8_t index, uint16_t data) {
-  if ( !displayDetected ) {
-    DoEvents();
-    return 0;
+  bool in_order = main_handler_active && handler_low_lane; /* behind a string the handler queued, keep the order it wrote in */
+  bool priority = !in_order && ( main_handler_active || GetWritePriority(object) == GENIE_PRIORITY_HIGH ); /* the handler answers the operator */
+  if ( priority ) {
+    GenieShadowEntry *entry = shadow_find(object, index);
+    if ( entry != nullptr && entry->batch ) priority = 0; /* stay behind the batch carrying this widget */
   }
-  uint8_t checksum = 0, buffer[7] = { (uint8_t)currentForm, GENIE_WRITE_OBJ, object, index, (uint8_t)(data >> 8), (uint8_t)data, 0 };
-  for ( uint8_t i = 1; i < 6; i++ ) checksum ^= buffer[i];
-  buffer[6] = checksum;
-  block_dequeue = 1; // disable dequeue
-  while ( pendingACK ) DoEvents(); // wait pending ACKs
 
-  writeMode(&buffer[1],6);
-
-  pendingACK = 1; // enable ACK check
-  pendingACK_timeout = millis(); // reset ACK check timer
-  while ( pendingACK ) DoEvents(); // wait pending ACKs
-  block_dequeue = 0; // re-enable dequeue
-
-  return 1;
+  if ( GENIE_OBJ_FORM == object ) { /* only the last form change matters */
+    uint8_t queued[7] = { 0, GENIE_WRITE_OBJ, GENIE_OBJ_FORM, 0, 0, 0, 0 };
+    while ( _outgoing_priority.findRemove<1,2>(queued,7) || _outgoing_queue.findRemove<1,2>(queued,7) );
+    currentForm = index; /* update the local form state immediately */
+  }
+  else if ( object != GENIE_OBJ_SCOPE && object != GENIE_OBJ_COOL_GAUGE ) { /* scope and cool gauge writes are samples, never merged */
+    if ( !in_order && _outgoing_priority.replace<1,2,3>(buffer,7) ) return;
+    if ( priority || in_order ) _outgoing_queue.findRemove<1,2,3>(buffer,7); /* superseded, and must not be sent after this one */
+    else if ( _outgoing_queue.replace<1,2,3>(buffer,7) ) return;
+  }
+  enqueue_frame(buffer, 7, priority);
 }
 
 
@@ -308,28 +892,114 @@ bool Genie::WriteObjectPriority(uint8_t object, uint8_t index, uint16_t data) {
 // ## Write Contrast #################### 
 // ######################################
 bool Genie::WriteContrast(uint8_t value) {
-  DoEvents();
+  poll_events();
   uint8_t checksum = 0, buffer[4] = { (uint8_t)currentForm, GENIE_WRITE_CONTRAST, value, 0 };
   for ( uint8_t i = 1; i < 3; i++ ) checksum ^= buffer[i];
   buffer[3] = checksum;
-  if ( !_outgoing_queue.replace(buffer,4,1,1,1) ) {
-    _outgoing_queue.push_back(buffer,4);
+  if ( !_outgoing_queue.replace<1>(buffer,4) ) {
+    enqueue_frame(buffer,4);
     return 0;
   }
   return 1;
 }
 
 
+// ######################################
+// ## Queue Frames ######################
+// ######################################
+void Genie::enqueue_frame(uint8_t *buffer, uint8_t length, bool priority) {
+  if ( priority ) { /* GENIE_WRITE_OBJ only, nothing in the payload buffer */
+    if ( _outgoing_priority.size() < _outgoing_priority.capacity() ) {
+      _outgoing_priority.push_back(buffer, length);
+      return;
+    }
+    if ( debug_enabled(GENIE_LOG_INFO) ) debugSerial->println(F("[Genie]: Priority queue full, frame queued as low priority"));
+  }
+  if ( main_handler_active ) handler_low_lane = 1; /* the rest of the handler's writes follow this frame */
+  if ( _outgoing_queue.size() == _outgoing_queue.capacity() ) { /* drop the oldest frame to make room */
+    if ( debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: Overflow writing frames to queue!"));
+    uint8_t oldest[7];
+    _outgoing_queue.pop_front(oldest, 7);
+    discard_frame(oldest);
+  }
+  _outgoing_queue.push_back(buffer, length);
+}
+
+void Genie::discard_frame(uint8_t *buffer) {
+  if ( buffer[1] == GENIE_READ_OBJ ) read_finish(buffer[2], buffer[3], GENIE_TX_DROPPED);
+  if ( !payload_length(buffer) ) return;
+  _outgoing_payload.erase(tx_held_payload(), payload_length(buffer)); /* queued behind the frame in flight */
+  set_write_status(((uint16_t)buffer[4] << 8) | buffer[5], GENIE_TX_DROPPED);
+  if ( buffer[1] == GENIE_WRITE_BATCH ) shadow_settle(((uint16_t)buffer[4] << 8) | buffer[5], 0);
+}
+
+uint16_t Genie::enqueue_payload_frame(uint8_t cmd, uint8_t index, uint8_t len, const uint8_t *payload, uint16_t payload_len) {
+  uint8_t wire_cmd = ( cmd == GENIE_WRITE_BATCH ) ? GENIEM_WRITE_DBYTES : cmd;
+  uint8_t checksum = wire_cmd ^ index ^ len;
+  for ( uint16_t i = 0; i < payload_len; i++ ) checksum ^= payload[i];
+
+  if ( ++tx_ticket_counter == GENIE_TICKET_UNCHANGED ) tx_ticket_counter = 1; /* ticket 0 is reserved for failures */
+  uint16_t ticket = tx_ticket_counter;
+
+  if ( payload_len > _outgoing_payload.capacity() ) { /* can never fit the queue, write it directly */
+    uint8_t header[3] = { wire_cmd, index, len };
+    block_dequeue = 1; // disable dequeue
+    while ( pendingACK || tx_stream_left ) DoEvents(); // wait pending ACKs
+    set_write_status(ticket, GENIE_TX_QUEUED);
+    writeMode(header, 3);
+    for ( uint16_t i = 0; i < payload_len; i += 255 ) writeMode((uint8_t*)&payload[i], ( payload_len - i < 255 ) ? payload_len - i : 255);
+    writeMode(&checksum, 1);
+    rx_last_frame = millis(); /* as for a streamed frame, the display was silent while it came in */
+    set_write_status(ticket, GENIE_TX_SENT);
+    tx_inflight_ticket = ticket;
+    pendingACK = 1; // enable ACK check
+    pendingACK_timeout = millis(); // reset ACK check timer
+    pendingACK_sent = micros();
+    while ( pendingACK ) DoEvents(); // wait pending ACKs
+    block_dequeue = 0; // re-enable dequeue
+    return ticket;
+  }
+
+  if ( _outgoing_payload.capacity() - _outgoing_payload.size() < payload_len ) {
+    if ( debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: Overflow writing payload to queue!"));
+    return 0;
+  }
+
+  for ( uint16_t i = 0; i < payload_len; i++ ) _outgoing_payload.write(payload[i]);
+  uint8_t buffer[7] = { (uint8_t)currentForm, cmd, index, len, (uint8_t)(ticket >> 8), (uint8_t)ticket, checksum };
+  enqueue_frame(buffer, 7);
+  set_write_status(ticket, GENIE_TX_QUEUED);
+  return ticket;
+}
+
 // ######################################
 // ## User Ping #########################
 // ######################################
 void Genie::Ping(uint16_t interval) {
   if ( displayDetected && millis() - pingSpacer > interval ) {
+    pingSpacer = millis();
+    ping_deferred = 1;
+    tx_control();
+  }
+}
+
+// Writes the ping and NAK recovery bytes asked for, once no frame is half way out.
+void Genie::tx_control() {
+  if ( tx_stream_left ) return; /* would land inside the frame, DoEvents calls again */
+  if ( ping_deferred ) {
+    ping_deferred = 0;
+    if ( !displayDetected ) return;
     uint8_t buffer[4] = { (uint8_t)GENIE_READ_OBJ, GENIE_OBJ_FORM , 0, 10 };
     writeMode(buffer,4);
+    flush_after_ping = 0;
     pingRequest = 1;
     pingResponse = micros();
-    pingSpacer = millis();
+  }
+  if ( recover_deferred ) {
+    recover_deferred = 0;
+    uint8_t flush = 0xFF;
+    writeMode(&flush, 1);
+    flush_after_ping = 1;
   }
 }
 
@@ -337,209 +1007,356 @@ void Genie::Ping(uint16_t interval) {
 // ## Write mode between bytes ##########
 // ######################################
 void Genie::writeMode(uint8_t *bytes, uint8_t len) {
-  for ( uint8_t i = 0; i < len; i++ ) {
+  if ( !tx_delay ) { /* hand the whole frame to the serial driver's transmit buffer */
+    deviceSerial->write(bytes, len);
+    return;
+  }
+  for ( uint8_t i = 0; i < len; i++ ) { /* paced, for displays behind SoftwareSerial or slow links */
     deviceSerial->write(bytes[i]);
     delayMicroseconds(tx_delay);
   }
 }
 
+// Feeds the rest of the dequeued payload frame, and then its checksum, to the UART
+// as its transmit buffer drains, so DoEvents never waits on a long frame. Serial
+// ports that do not report availableForWrite() get the whole frame at once.
+void Genie::tx_stream() {
+  uint8_t chunk[16];
+  while ( tx_stream_left ) {
+    uint16_t room = sizeof(chunk);
+    if ( tx_buffered ) {
+      room = deviceSerial->availableForWrite();
+      if ( !room ) return; /* continue on a later DoEvents */
+    }
+    uint8_t count = 0;
+    while ( count < sizeof(chunk) && count < room && tx_stream_left ) {
+      chunk[count++] = ( tx_stream_left > 1 ) ? _outgoing_payload.peek(tx_stream_pos++) : tx_stream_crc;
+      tx_stream_left--;
+    }
+    writeMode(chunk, count);
+  }
+  pendingACK = 1; /* last byte is with the driver, wait for the display's answer */
+  pendingACK_timeout = millis();
+  pendingACK_sent = micros();
+}
+
 // ######################################
 // ## Do Events #########################
 // ######################################
 inline int16_t Genie::DoEvents() {
 
   if ( !displayDetected ) {
-    if ( deviceSerial->available() > 24) while(deviceSerial->available()) deviceSerial->read();
+    if ( deviceSerial->available() > 24) {
+      while(deviceSerial->available()) deviceSerial->read();
+      rx_count = 0;
+    }
     currentForm = -1;
-    pendingACK = 0;
+    tx_abort(); /* nothing will answer it */
+    if ( probe_serial != nullptr && millis() - probe_since > GENIE_BAUD_PROBE_TIME ) probe_next();
   }
+  if ( tx_stream_left ) tx_stream();
+  if ( ping_deferred || recover_deferred ) tx_control();
 
   /* Compatibility with sketches that include reset in setup, to prevent disconnection */
-  if ( displayDetected && (millis() < 7000) ) display_uptime = millis();
-
-  uint32_t autoPing_swapSpeed;
-
-  if ( millis() - autoPingTimer > ( ( displayDetected && !NAK_detected ) ? autoPing_swapSpeed = AUTO_PING_CYCLE : autoPing_swapSpeed = recover_pulse ) ) {
-    autoPingTimer = millis();
-    if ( displayDetected && millis() - display_uptime > DISPLAY_TIMEOUT ) {
-      display_uptime = millis();
-       if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: disconnected by display timeout"));
-      uint8_t buffer[6] = { GENIE_DISCONNECTED, 0, 0, 0, 0 };
-      _incomming_queue.push_back(buffer, 6);
-      displayDetected = 0;
-    }
+  if ( displayDetected && (millis() < 7000) ) display_uptime = rx_last_frame = millis();
+
+  uint32_t now = millis();
+  if ( tx_stream_left ) rx_last_frame = now; /* the display cannot answer before the frame going out ends */
+  if ( displayDetected && now - rx_last_frame > display_timeout ) {
+    display_uptime = rx_last_frame = now;
+    if ( debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: disconnected by display timeout"));
+    uint8_t buffer[6] = { GENIE_DISCONNECTED, 0, 0, 0, 0 };
+    queue_event(buffer);
+    displayDetected = 0;
+    tx_abort(); /* unanswered, or its recovery never came */
+    shadow_invalidate();
+    if ( currentForm >= 0 ) replay_form = currentForm; /* may have been changed on the display itself */
+  }
+
+  if ( ( UserConnectionHandler != nullptr || UserConnectionContextHandler != nullptr ) && link_reported != displayDetected ) {
+    link_reported = displayDetected; /* first, the handler may call DoEvents() */
+    if ( UserConnectionHandler != nullptr ) UserConnectionHandler(displayDetected);
+    else UserConnectionContextHandler(*this, displayDetected, connection_context);
+  }
+
+  /* online, ping only once the display has been silent for ping_idle; offline or recovering, every recover_pulse */
+  bool ping_due;
+  if ( displayDetected && !NAK_detected ) ping_due = ( now - rx_last_frame > ping_idle ) && ( now - autoPingTimer > ping_idle );
+  else ping_due = ( now - autoPingTimer > recover_pulse );
+  if ( ping_due && !tx_stream_left ) { /* never inside a frame still being sent */
+    autoPingTimer = now;
     uint8_t buffer[4] = { (uint8_t)GENIE_READ_OBJ, GENIE_OBJ_FORM , 0, 10 };
     writeMode(buffer,4);
+    flush_after_ping = 0;
     autoPingFlag = 1;
+    autoPing_sent = micros();
   }
 
-  if ( deviceSerial->available() > 0 ) {
-    switch ( deviceSerial->peek() ) {
-      case GENIE_REPORT_OBJ: {
-          if ( deviceSerial->available() >= 6 ) {
-            uint8_t buffer[6], checksum = 0;
-            for ( uint8_t i = 0; i < 6; i++ ) {
-              buffer[i] = deviceSerial->read();
-              if ( i < 5 ) checksum ^= buffer[i];
-            }
-            if ( checksum == buffer[5] ) {
-              if ( GENIE_OBJ_FORM == buffer[1] ) {
-                currentForm = buffer[4];
-                if ( !displayDetected ) {
-                  if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: online"));
-                  uint8_t buffer[6] = { GENIE_READY, 0, 0, 0, 0 };
-                  if ( UserHandler != nullptr ) _incomming_queue.push_back(buffer, 6);
-                  displayDetected = 1;
-                  display_uptime = millis();
-                  genieStart = 0;
-                  return GENIE_REPORT_OBJ;
-                }
-                if ( NAK_detected ) {
-                  if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: Recovered from NAK(s)"));
-                  NAK_recovery_counter = 0;
-                  NAK_detected = 0;
-                  return GENIE_REPORT_OBJ;
-                }
-                if ( autoPingFlag ) {
-                  autoPingFlag = 0;
-                  if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: AutoPing success!"));
-                  display_uptime = millis();
-                  return GENIE_REPORT_OBJ;
-                }
-                if ( pingRequest ) {
-                  pingRequest = 0;
-                  uint32_t _time = micros() - pingResponse;
-                  uint8_t buffer[6] = { GENIE_PING, (uint8_t)(_time >> 24), (uint8_t)(_time >> 16), (uint8_t)(_time >> 8), (uint8_t)(_time) };
-                  _incomming_queue.push_back(buffer, 6);
-                  return GENIE_REPORT_OBJ;
-                }
-              }
-              if ( !displayDetected ) return 0; // block the ping request events when offline
-              if ( handler_response_request && handler_response_values[1] == buffer[1] && handler_response_values[2] == buffer[2] ) {
-                memmove(handler_response_values, buffer, 6);
-                handler_response_request = 0;
-                return GENIE_REPORT_OBJ;
-              }
-              _incomming_queue.push_back(buffer, 6);
-            }
-          }
-          return GENIE_REPORT_OBJ;
-        }
-      case GENIE_REPORT_EVENT: {
-          if ( deviceSerial->available() >= 6 ) {
-            uint8_t buffer[6], checksum = 0;
-            for ( uint8_t i = 0; i < 6; i++ ) {
-              buffer[i] = deviceSerial->read();
-              if ( i < 5 ) checksum ^= buffer[i];
-            }
-            if ( checksum == buffer[5] ) {
-              if ( GENIE_OBJ_FORM == buffer[1] ) currentForm = buffer[4];
-              if ( GENIE_OBJ_4DBUTTON != buffer[1] &&
-                   GENIE_OBJ_USERBUTTON != buffer[1] ) {
-                if ( !_incomming_queue.replace(buffer,6,0,1,2 ) ) _incomming_queue.push_back(buffer, 6);
-              }
-              else _incomming_queue.push_back(buffer, 6);
-            }
-          }
-          return GENIE_REPORT_EVENT;
-        }
+  if ( rx_count && millis() - rx_last_byte > GENIE_RX_TIMEOUT ) {
+    if ( displayDetected && debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: Partial frame timed out"));
+    rx_count = 0;
+  }
 
-      case GENIEM_REPORT_BYTES: {
-          if ( !displayDetected ) { deviceSerial->read(); return 0; }
-          if ( deviceSerial->available() < 4 ) break; // magic report event less than 3 bytes? check again.
-          uint8_t data[] = { (uint8_t)deviceSerial->read(), (uint8_t)deviceSerial->read(), (uint8_t)deviceSerial->read() };
-          magic_report_len = data[2];
-          magic_overpull_count = 0;
-          if ( UserByteReader != nullptr ) {
-            UserByteReader( data[1], data[2] );
-            if ( magic_report_len > 0 ) {
-              if ( debugSerial != nullptr ) {
-                debugSerial->print(F("[Genie]: User forgot "));
-                debugSerial->print(magic_report_len);
-                debugSerial->println(F(" magic byte(s). Flushing rest..."));
-              }
-              uint32_t timeout = millis();
-              while ( magic_report_len && millis() - timeout < 100 ) {
-                if ( deviceSerial->available() > 0 ) {
-                  magic_report_len--;
-                  deviceSerial->read();
-                  timeout = millis();
-                }
-              }
-            }
-            else {
-              if ( debugSerial != nullptr ) {
-                if ( !magic_overpull_count ) debugSerial->println(F("[Genie]: User captured all magic bytes!"));
-                else {
-                  debugSerial->print(F("[Genie]: User captured all magic bytes, but tried to pull more than provided! ("));
-                  debugSerial->print(magic_overpull_count);
-                  debugSerial->println(F(" byte(s))")); 
-                }
-              }
-            }
-            display_uptime = millis();
-          }
-          else {
-            if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: MMagic bytes callback not set!"));
-            for ( uint16_t i = 0; i < data[2]; i++) deviceSerial->read();
-          }
-          uint32_t timeout = millis();
-          while ( millis() - timeout < 5000 && deviceSerial->available() < 1 );
-          deviceSerial->read();
-          return GENIEM_REPORT_BYTES;
-        }
+  rx_nak_run = 0;
+  int16_t event = -1;
+  while ( deviceSerial->available() > 0 ) { /* one complete frame per call */
+    int16_t parsed = rx_parse(deviceSerial->read());
+    if ( parsed < 0 ) continue;
+    event = parsed;
+    if ( event != GENIE_NAK ) return event;
+  }
+  if ( event == GENIE_NAK ) return GENIE_NAK;
 
-      case GENIEM_REPORT_DBYTES: {
-          if ( !displayDetected ) { deviceSerial->read(); return 0; }
-          if ( deviceSerial->available() < 3 ) break; // magic report event less than 3 bytes? check again.
-          uint8_t data[] = { (uint8_t)deviceSerial->read(), (uint8_t)deviceSerial->read(), (uint8_t)deviceSerial->read() };
-          if ( UserDoubleByteReader != nullptr ) {
-            UserDoubleByteReader( data[1], data[2] );
-            (void)GetNextByte();
-            return GENIEM_REPORT_DBYTES;
-            // over/under pulling protection to be implemented as above
-          }
-          else {
-            if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: Magic double bytes callback not set!"));
-            for ( uint16_t i = 0; i < 2 * data[2]; i++) deviceSerial->read();
-          }
-          uint32_t timeout = millis();
-          while ( millis() - timeout < 5000 && deviceSerial->available() < 1 );
-          deviceSerial->read();
-          return GENIEM_REPORT_DBYTES;
-        }
+  if ( _outgoing_queue.size() + _outgoing_priority.size() > link_stats.tx_queue_high ) link_stats.tx_queue_high = _outgoing_queue.size() + _outgoing_priority.size();
+  if ( _outgoing_payload.size() > link_stats.payload_high ) link_stats.payload_high = _outgoing_payload.size();
+  dequeue_processing();
+  read_service();
+  if ( replay_pos < 2 * GENIE_SHADOW_SIZE ) shadow_replay();
+  if ( _incomming_queue.size() > link_stats.rx_queue_high ) link_stats.rx_queue_high = _incomming_queue.size();
+  if ( !main_handler_active && _incomming_queue.size() && handler_attached() ) {
+    main_handler_active = 1;
+    handler_low_lane = 0;
+    if ( UserHandler != nullptr ) UserHandler();
+    else UserContextHandler(*this, handler_context);
+    main_handler_active = 0;
+    dequeue_processing(); /* start on the writes the handler queued */
+  }
+  return -1;
+}
 
+// ######################################
+// ## Receive Parser ####################
+// ######################################
+// Consumes one received byte. Returns the command of a frame completed by this byte,
+// 0 if the byte was dropped while offline, or -1 while a frame is still incomplete.
+int16_t Genie::rx_parse(uint8_t data) {
+  if ( !rx_count ) {
+    if ( data != GENIE_NAK ) rx_nak_run = 0;
+    switch ( data ) {
       case GENIE_ACK: {
-          deviceSerial->read();
-          if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: Received ACK!"));
+          if ( debug_enabled(GENIE_LOG_DEBUG) ) debugSerial->println(F("[Genie]: Received ACK!"));
+          link_stats.acks++;
+          NAK_recovery_counter = 0;
+          /* a stray or late ACK, such as one for a garbled frame during NAK recovery, must not
+             settle a frame that is still being sent or is waiting to go out again */
+          if ( !pendingACK || tx_stream_left ) return GENIE_ACK;
+          link_record(link_stats.ack, micros() - pendingACK_sent);
+          rx_last_frame = millis(); /* only an expected ACK shows the display is there */
+          if ( tx_inflight_held && !tx_retries && ack_adaptive(tx_inflight) ) ack_measure(micros() - pendingACK_sent);
           pendingACK = 0;
+          tx_finish();
+          set_write_status(tx_inflight_ticket, GENIE_TX_ACKED);
+          shadow_settle(tx_inflight_ticket, 1);
+          tx_inflight_ticket = 0;
+          if ( tx_inflight_write ) shadow_store(tx_inflight_object, tx_inflight_index, tx_inflight_value);
+          tx_inflight_write = 0;
           return GENIE_ACK;
         }
       case GENIE_NAK: {
-          while ( deviceSerial->peek() == GENIE_NAK ) deviceSerial->read();
-          if ( !genieStart && !NAK_detected && debugSerial != nullptr ) debugSerial->println(F("[Genie]: Received NAK!"));
+          if ( rx_nak_run ) return -1; /* rest of the same burst */
+          rx_nak_run = 1;
+          link_stats.naks++;
+          bool answer = pendingACK && !tx_stream_left; /* else a leftover, the frame in flight is not answered yet */
+          if ( answer ) rx_last_frame = millis();
+          bool resend = tx_resend || ( answer && tx_retry() ); /* NAKs before the recovery are leftovers */
+          if ( answer ) pendingACK = 0; /* answered, even if not acknowledged */
+          if ( !genieStart && !NAK_detected && debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: Received NAK!"));
           NAK_detected = 1;
           NAK_recovery_counter++;
+          if ( answer && !resend ) tx_fail(GENIE_TX_NAKED);
           if ( NAK_recovery_counter >= 2 ) {
             NAK_recovery_counter = 0;
-            deviceSerial->write(0xFF);
+            recover_deferred = 1;
+            tx_control();
           }
           return GENIE_NAK;
         }
+      case GENIE_REPORT_OBJ:
+      case GENIE_REPORT_EVENT: {
+          rx_expected = GENIE_FRAME_SIZE;
+          break;
+        }
+      case GENIEM_REPORT_BYTES:
+      case GENIEM_REPORT_DBYTES: {
+          if ( !displayDetected ) return 0;
+          rx_expected = 4; /* cmd, index, len, crc until len is known */
+          rx_magic_overflow = 0;
+#if GENIE_MAGIC_SUPPORT && GENIE_MAGIC_BUFFER_SIZE
+          _incomming_magic.clear();
+#endif
+          break;
+        }
       default: {
-          if ( displayDetected && !NAK_detected && debugSerial != nullptr ) {
+          if ( displayDetected && !NAK_detected && debug_enabled(GENIE_LOG_DEBUG) ) {
             debugSerial->print(F("[Genie]: Bad Byte: "));
-            debugSerial->println(deviceSerial->read());
+            debugSerial->println(data);
           }
-          break;
+          return -1;
         }
     }
+    rx_checksum = 0;
   }
-  dequeue_processing();
-  if ( !main_handler_active && _incomming_queue.size() && UserHandler != nullptr ) {
-    main_handler_active = 1;
-    UserHandler();
-    main_handler_active = 0;
+
+  rx_last_byte = millis();
+  rx_checksum ^= data;
+  if ( rx_count < 3 ) rx_frame[rx_count] = data;
+  bool magic = ( rx_frame[0] == GENIEM_REPORT_BYTES || rx_frame[0] == GENIEM_REPORT_DBYTES );
+  if ( !magic ) rx_frame[rx_count] = data;
+  else if ( rx_count == 2 ) rx_expected = 4 + (( rx_frame[0] == GENIEM_REPORT_DBYTES ) ? 2 : 1) * (uint16_t)data;
+#if GENIE_MAGIC_SUPPORT
+  else if ( rx_count >= 3 && rx_count < rx_expected - 1 ) { /* payload */
+    if ( magic_buffer != nullptr ) {
+      if ( rx_count - 3 < magic_buffer_size ) magic_buffer[rx_count - 3] = data;
+      else rx_magic_overflow = 1;
+    }
+#if GENIE_MAGIC_BUFFER_SIZE
+    else if ( _incomming_magic.size() < _incomming_magic.capacity() ) _incomming_magic.write(data);
+    else rx_magic_overflow = 1;
+#endif
+  }
+#endif
+  if ( ++rx_count < rx_expected ) return -1;
+
+  rx_count = 0;
+  if ( rx_checksum ) { /* xor over a whole frame, checksum included, is 0 */
+    if ( displayDetected && debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: Bad checksum, frame dropped"));
+    return rx_frame[0];
+  }
+  rx_last_frame = millis();
+  return rx_dispatch();
+}
+
+// Handles the complete, checksum verified frame in rx_frame (and _incomming_magic).
+int16_t Genie::rx_dispatch() {
+  switch ( rx_frame[0] ) {
+    case GENIE_REPORT_OBJ: {
+        if ( GENIE_OBJ_FORM == rx_frame[1] ) {
+          uint8_t queued[7] = { 0, GENIE_WRITE_OBJ, GENIE_OBJ_FORM, 0, 0, 0, 0 };
+          bool form_queued = ( tx_inflight_write && tx_inflight_object == GENIE_OBJ_FORM ) ||
+                             _outgoing_priority.find<1,2>(queued,7) || _outgoing_queue.find<1,2>(queued,7);
+          bool form_lost = displayDetected && !form_queued && currentForm >= 0 && rx_frame[4] != currentForm; /* changed without a form event */
+          if ( !form_queued ) currentForm = rx_frame[4]; /* else keep the form SetForm is changing to */
+          if ( form_lost ) { /* likely reset inside the display timeout, its widgets may be blank */
+            if ( debug_enabled(GENIE_LOG_INFO) ) debugSerial->println(F("[Genie]: Unexpected form report, resending widgets"));
+            shadow_invalidate();
+            replay_pos = 0;
+          }
+          if ( !displayDetected ) {
+            if ( debug_enabled(GENIE_LOG_INFO) ) debugSerial->println(F("[Genie]: online"));
+            uint8_t buffer[6] = { GENIE_READY, 0, 0, 0, 0 };
+            if ( handler_attached() ) queue_event(buffer);
+            displayDetected = 1;
+            if ( probe_serial != nullptr ) {
+              baud_rate = probe_bauds[probe_index];
+              probe_serial = nullptr;
+              if ( debug_enabled(GENIE_LOG_INFO) ) {
+                debugSerial->print(F("[Genie]: Display found at "));
+                debugSerial->print(baud_rate);
+                debugSerial->println(F(" baud"));
+              }
+            }
+            shadow_invalidate();
+            if ( replay_form >= 0 && replay_form != currentForm ) queue_write(GENIE_OBJ_FORM, replay_form, 0, GENIE_WRITE_OBJ ^ GENIE_OBJ_FORM ^ replay_form); /* back to the form it was on */
+            replay_pos = 0;
+            display_uptime = millis();
+            genieStart = 0;
+            autoPingFlag = 0; /* this report answers the outstanding ping */
+            return GENIE_REPORT_OBJ;
+          }
+          if ( NAK_detected ) {
+            if ( flush_after_ping ) return GENIE_REPORT_OBJ; /* the NAK for a later 0xFF is still to come, the next ping confirms */
+            if ( debug_enabled(GENIE_LOG_INFO) ) debugSerial->println(F("[Genie]: Recovered from NAK(s)"));
+            NAK_recovery_counter = 0;
+            NAK_detected = 0;
+            autoPingFlag = 0;
+            return GENIE_REPORT_OBJ;
+          }
+          if ( autoPingFlag ) {
+            autoPingFlag = 0;
+            link_record(link_stats.ping, micros() - autoPing_sent);
+            if ( debug_enabled(GENIE_LOG_DEBUG) ) debugSerial->println(F("[Genie]: AutoPing success!"));
+            display_uptime = millis();
+            return GENIE_REPORT_OBJ;
+          }
+          if ( pingRequest ) {
+            pingRequest = 0;
+            uint32_t _time = micros() - pingResponse;
+            link_record(link_stats.ping, _time);
+            uint8_t buffer[6] = { GENIE_PING, (uint8_t)(_time >> 24), (uint8_t)(_time >> 16), (uint8_t)(_time >> 8), (uint8_t)(_time) };
+            queue_event(buffer);
+            return GENIE_REPORT_OBJ;
+          }
+        }
+        if ( !displayDetected ) return 0; // block the ping request events when offline
+        shadow_report(rx_frame[1], rx_frame[2], ((uint16_t)rx_frame[3] << 8) | rx_frame[4]);
+        bool requested = read_finish(rx_frame[1], rx_frame[2], GENIE_TX_ACKED, ((uint16_t)rx_frame[3] << 8) | rx_frame[4]);
+        if ( handler_response_request && handler_response_values[1] == rx_frame[1] && handler_response_values[2] == rx_frame[2] ) {
+          memmove(handler_response_values, rx_frame, 6);
+          handler_response_request = 0;
+          return GENIE_REPORT_OBJ;
+        }
+        if ( !requested ) queue_event(rx_frame); /* ReadObjectAsync() answers are not events */
+        return GENIE_REPORT_OBJ;
+      }
+
+    case GENIE_REPORT_EVENT: {
+        if ( GENIE_OBJ_FORM == rx_frame[1] ) currentForm = rx_frame[4];
+        shadow_report(rx_frame[1], rx_frame[2], ((uint16_t)rx_frame[3] << 8) | rx_frame[4], 1);
+        queue_event(rx_frame);
+        return GENIE_REPORT_EVENT;
+      }
+
+    case GENIEM_REPORT_BYTES:
+    case GENIEM_REPORT_DBYTES: {
+#if GENIE_MAGIC_SUPPORT
+        bool dbytes = ( rx_frame[0] == GENIEM_REPORT_DBYTES );
+        if ( rx_magic_overflow ) {
+          if ( debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: Magic report larger than the magic buffer, dropped"));
+          return rx_frame[0];
+        }
+        if ( UserMagicReceiver != nullptr || UserMagicContextReceiver != nullptr ) { /* whole payload is already in the caller's buffer */
+          if ( UserMagicReceiver != nullptr ) UserMagicReceiver(rx_frame[1], magic_buffer, rx_expected - 4, dbytes);
+          else UserMagicContextReceiver(*this, rx_frame[1], magic_buffer, rx_expected - 4, dbytes, magic_context);
+          display_uptime = millis();
+          return rx_frame[0];
+        }
+#if GENIE_MAGIC_BUFFER_SIZE
+        magic_report_len = _incomming_magic.size();
+        magic_overpull_count = 0;
+        if ( dbytes ? ( UserDoubleByteReader != nullptr || UserDoubleByteContextReader != nullptr ) : ( UserByteReader != nullptr || UserByteContextReader != nullptr ) ) {
+          if ( dbytes && UserDoubleByteReader != nullptr ) UserDoubleByteReader( rx_frame[1], rx_frame[2] );
+          else if ( dbytes ) UserDoubleByteContextReader( *this, rx_frame[1], rx_frame[2], dbyte_context );
+          else if ( UserByteReader != nullptr ) UserByteReader( rx_frame[1], rx_frame[2] );
+          else UserByteContextReader( *this, rx_frame[1], rx_frame[2], byte_context );
+          if ( magic_report_len > 0 ) {
+            if ( debug_enabled(GENIE_LOG_INFO) ) {
+              debugSerial->print(F("[Genie]: User forgot "));
+              debugSerial->print(magic_report_len);
+              debugSerial->println(F(" magic byte(s). Flushing rest..."));
+            }
+          }
+          else if ( magic_overpull_count ) {
+            if ( debug_enabled(GENIE_LOG_INFO) ) {
+              debugSerial->print(F("[Genie]: User captured all magic bytes, but tried to pull more than provided! ("));
+              debugSerial->print(magic_overpull_count);
+              debugSerial->println(F(" byte(s))"));
+            }
+          }
+          else if ( debug_enabled(GENIE_LOG_DEBUG) ) debugSerial->println(F("[Genie]: User captured all magic bytes!"));
+          display_uptime = millis();
+        }
+        else if ( debug_enabled(GENIE_LOG_INFO) ) {
+          if ( dbytes ) debugSerial->println(F("[Genie]: Magic double bytes callback not set!"));
+          else debugSerial->println(F("[Genie]: Magic bytes callback not set!"));
+        }
+        _incomming_magic.clear();
+        magic_report_len = 0;
+#else
+        if ( debug_enabled(GENIE_LOG_INFO) ) debugSerial->println(F("[Genie]: Magic report skipped, no AttachMagicReceiver buffer"));
+#endif
+#endif
+        return rx_frame[0]; /* without GENIE_MAGIC_SUPPORT the report is only skipped */
+      }
   }
   return -1;
 }
@@ -550,36 +1367,151 @@ inline int16_t Genie::DoEvents() {
 
 void Genie::dequeue_processing() {
   if ( pendingACK ) { /* check if ACK timeout, clear flag */
-    if ( millis() - pendingACK_timeout >= 500 ) {
-      if ( debugSerial != nullptr ) debugSerial->println(F("[Genie]: ACK timeout!"));
-      pendingACK = 0;
+    bool adaptive = tx_inflight_held && ack_adaptive(tx_inflight);
+    if ( millis() - pendingACK_timeout < ( adaptive ? ack_timeout : GENIE_ACK_TIMEOUT ) ) return;
+    if ( debug_enabled(GENIE_LOG_ERROR) ) debugSerial->println(F("[Genie]: ACK timeout!"));
+    link_stats.ack_timeouts++;
+    pendingACK = 0;
+    if ( adaptive ) ack_timeout = ( ack_timeout < GENIE_ACK_TIMEOUT / 2 ) ? 2 * ack_timeout : GENIE_ACK_TIMEOUT; /* back off until an ACK is measured again */
+    if ( !tx_retry() ) {
+      tx_fail(GENIE_TX_TIMEOUT);
+      return;
     }
   }
-  else { /* if no ACK is expected, send another request from queue */
-    if ( !block_dequeue && displayDetected && !NAK_detected && _outgoing_queue.size() ) {
-      uint8_t _dequeued_buffer[7];
-      _outgoing_queue.pop_front(_dequeued_buffer, 7);
-      switch ( _dequeued_buffer[1] ) {
-        case GENIE_WRITE_CONTRAST: {
-            writeMode(&_dequeued_buffer[1], 3); /* allow writing to any form pages. */
-            // if ( _dequeued_buffer[0] == currentForm ) writeMode(&_dequeued_buffer[1], 3); /* only allow writes to current form */
-            break;
-          }
-        case GENIE_READ_OBJ: { 
-            writeMode(&_dequeued_buffer[1], 4);
-            // if ( _dequeued_buffer[0] == currentForm ) writeMode(&_dequeued_buffer[1], 4);
-            return;
-          }
-        case GENIE_WRITE_OBJ: {
-            writeMode(&_dequeued_buffer[1], 6);
-            // if ( _dequeued_buffer[0] == currentForm ) writeMode(&_dequeued_buffer[1], 6);
-            break;
-          }
-      }
-      pendingACK = 1;
-      pendingACK_timeout = millis();
+  if ( tx_stream_left ) return;
+  if ( tx_resend ) { /* NAKed or timed out, goes out again ahead of everything else once the link is back */
+    if ( NAK_detected ) {
+      if ( millis() - tx_resend_since >= GENIE_ACK_TIMEOUT ) tx_fail(GENIE_TX_TIMEOUT); /* the display never answered the recovery ping */
+      return;
+    }
+    tx_resend = 0;
+    tx_send(tx_inflight);
+    return;
+  }
+  /* if no ACK is expected, send another request from queue */
+  if ( !block_dequeue && displayDetected && !NAK_detected && ( _outgoing_queue.size() || _outgoing_priority.size() ) ) {
+    tx_finish(); /* a frame left over from a disconnect */
+    if ( _outgoing_priority.size() && ( !_outgoing_queue.size() || tx_priority_run < GENIE_PRIORITY_BURST ) ) {
+      _outgoing_priority.pop_front(tx_inflight, 7);
+      tx_priority_run++;
     }
+    else { /* nothing urgent, or a low priority frame has waited out a burst */
+      _outgoing_queue.pop_front(tx_inflight, 7);
+      tx_priority_run = 0;
+    }
+    tx_send(tx_inflight);
+  }
+}
+
+// Writes a frame popped from the outgoing queues, or sends tx_inflight again.
+// Anything that is answered by an ACK is held in tx_inflight until it is.
+void Genie::tx_send(uint8_t *frame) {
+  tx_inflight_ticket = 0; /* set below for frames that carry one */
+  tx_inflight_write = 0;
+  switch ( frame[1] ) {
+    case GENIE_WRITE_CONTRAST: {
+        writeMode(&frame[1], 3); /* allow writing to any form pages. */
+        // if ( frame[0] == currentForm ) writeMode(&frame[1], 3); /* only allow writes to current form */
+        break;
+      }
+    case GENIE_READ_OBJ: {
+        writeMode(&frame[1], 4);
+        for ( uint8_t i = 0; i < GENIE_READS_TRACKED; i++ ) {
+          if ( reads[i].status != GENIE_TX_QUEUED || reads[i].object != frame[2] || reads[i].index != frame[3] ) continue;
+          reads[i].status = GENIE_TX_SENT;
+          reads[i].sent = millis();
+        }
+        // if ( frame[0] == currentForm ) writeMode(&frame[1], 4);
+        return;
+      }
+    case GENIE_WRITE_OBJ: {
+        writeMode(&frame[1], 6);
+        // if ( frame[0] == currentForm ) writeMode(&frame[1], 6);
+        tx_inflight_write = 1;
+        tx_inflight_object = frame[2];
+        tx_inflight_index = frame[3];
+        tx_inflight_value = ((uint16_t)frame[4] << 8) | frame[5];
+        break;
+      }
+    case GENIE_WRITE_BATCH:
+    case GENIE_WRITE_STR:
+    case GENIE_WRITE_STRU:
+    case GENIE_WRITE_INH_LABEL:
+    case GENIEM_WRITE_BYTES:
+    case GENIEM_WRITE_DBYTES: {
+        uint8_t header[3] = { ( frame[1] == GENIE_WRITE_BATCH ) ? (uint8_t)GENIEM_WRITE_DBYTES : frame[1], frame[2], frame[3] };
+        writeMode(header, 3);
+        tx_inflight_ticket = ((uint16_t)frame[4] << 8) | frame[5];
+        set_write_status(tx_inflight_ticket, GENIE_TX_SENT);
+        tx_inflight_held = 1;
+        tx_stream_pos = 0;
+        tx_stream_left = payload_length(frame) + 1; /* payload, crc */
+        tx_stream_crc = frame[6];
+        tx_stream(); /* waits for the ACK once the last byte is out */
+        return;
+      }
+  }
+  tx_inflight_held = 1;
+  pendingACK = 1;
+  pendingACK_timeout = millis();
+  pendingACK_sent = micros();
+}
+
+// Called when the frame in flight is NAKed or times out. Returns 1 if it will be
+// sent again once the link is resynchronised, else lets it go.
+bool Genie::tx_retry() {
+#if GENIE_TX_RETRIES == 0
+  tx_finish();
+  return 0;
+#else
+  if ( !tx_inflight_held || tx_retries >= GENIE_TX_RETRIES || !displayDetected ) {
+    tx_finish();
+    return 0;
   }
+  if ( debug_enabled(GENIE_LOG_INFO) ) debugSerial->println(F("[Genie]: Sending frame again"));
+  tx_retries++;
+  tx_resend = 1;
+  link_stats.retries++;
+  /* Resending straight away could land in a half received frame and shift every answer
+     after it onto the wrong frame. A form ping goes first, its report shows the display
+     has answered everything before it, then the recovery sends the frame again. */
+  NAK_detected = 1;
+  autoPingTimer = millis() - recover_pulse - 1;
+  tx_resend_since = millis();
+  return 1;
+#endif
+}
+
+// The frame in flight, or the last one sent, was not taken by the display.
+void Genie::tx_fail(uint8_t status) {
+  tx_finish();
+  set_write_status(tx_inflight_ticket, status);
+  shadow_settle(tx_inflight_ticket, 0);
+  tx_inflight_ticket = 0;
+  if ( tx_inflight_write ) shadow_forget(tx_inflight_object, tx_inflight_index);
+  tx_inflight_write = 0;
+}
+
+// The link was lost or reset. The frame in flight, even one half sent, will never
+// be answered: its ticket ends GENIE_TX_TIMEOUT.
+void Genie::tx_abort() {
+  pendingACK = 0;
+  if ( !tx_inflight_held && !tx_stream_left && !tx_inflight_ticket ) return;
+  tx_stream_left = 0;
+  tx_fail(GENIE_TX_TIMEOUT);
+}
+
+// Lets go of the frame in flight, and of its payload, unless it is still being sent.
+void Genie::tx_finish() {
+  if ( tx_stream_left ) return;
+  _outgoing_payload.erase(0, tx_held_payload());
+  tx_inflight_held = 0;
+  tx_resend = 0;
+  tx_retries = 0;
+}
+
+uint16_t Genie::tx_held_payload() {
+  return tx_inflight_held ? payload_length(tx_inflight) : 0;
 }
 
 // ######################################
@@ -590,35 +1522,104 @@ void Genie::DequeueEvent(genieFrame * buff) {
   event_frame = *buff;
 }
 
+// ######################################
+// ## Number Formatting #################
+// ######################################
+// Digits are written backwards, ending just before end, and the first character is
+// returned. Nothing is allocated and integers never touch floating point.
+
+char* genie_format_unsigned(char *end, unsigned long n, int base) {
+  if ( base < 2 || base > 36 ) base = 10;
+  if ( base == 10 ) { /* constant divisor, the compiler can avoid a division per digit */
+    do {
+      unsigned long m = n;
+      n /= 10;
+      *--end = '0' + (char)(m - 10 * n);
+    } while ( n );
+    return end;
+  }
+  do {
+    unsigned long m = n;
+    n /= base;
+    char c = m - base * n;
+    *--end = c < 10 ? c + '0' : c + 'A' - 10;
+  } while ( n );
+  return end;
+}
+
+char* genie_format_long(char *end, long n, int base) {
+  if ( n >= 0 || ( base >= 2 && base != 10 ) ) return genie_format_unsigned(end, (unsigned long)n, base); /* other bases show the two's complement */
+  end = genie_format_unsigned(end, 0UL - (unsigned long)n, 10);
+  *--end = '-';
+  return end;
+}
+
+static char* genie_format_decimals(char *end, unsigned long n, uint8_t decimals) {
+  if ( decimals > GENIE_FIXED_DECIMALS_MAX ) decimals = GENIE_FIXED_DECIMALS_MAX;
+  for ( uint8_t i = 0; i < decimals; i++ ) {
+    unsigned long m = n;
+    n /= 10;
+    *--end = '0' + (char)(m - 10 * n);
+  }
+  if ( decimals ) *--end = '.';
+  return genie_format_unsigned(end, n, 10);
+}
+
+char* genie_format_fixed(char *end, long value, uint8_t decimals) {
+  end = genie_format_decimals(end, ( value < 0 ) ? 0UL - (unsigned long)value : (unsigned long)value, decimals);
+  if ( value < 0 ) *--end = '-';
+  return end;
+}
+
+// Formats as Print::print(double, digits) does, digit for digit: one rounding term
+// added up front, then each decimal taken off the fraction with a multiply by 10.
+char* genie_format_double(char *end, double number, int digits) {
+  const char *special = nullptr;
+  if ( isnan(number) ) special = "nan";
+  else if ( isinf(number) ) special = "inf";
+  else if ( number > 4294967040.0 || number < -4294967040.0 ) special = "ovf"; /* as Print */
+  if ( special != nullptr ) {
+    end -= 3;
+    memcpy(end, special, 3);
+    return end;
+  }
+  bool negative = ( number < 0.0 );
+  if ( negative ) number = -number;
+  if ( digits < 0 ) digits = 0;
+  if ( digits > GENIE_FIXED_DECIMALS_MAX ) digits = GENIE_FIXED_DECIMALS_MAX;
+  double rounding = 0.5;
+  for ( int i = 0; i < digits; i++ ) rounding /= 10.0;
+  number += rounding;
+  unsigned long whole = (unsigned long)number;
+  double remainder = number - (double)whole;
+  end -= digits;
+  for ( int i = 0; i < digits; i++ ) {
+    remainder *= 10.0;
+    unsigned int digit = (unsigned int)remainder;
+    end[i] = '0' + digit;
+    remainder -= digit;
+  }
+  if ( digits ) *--end = '.';
+  end = genie_format_unsigned(end, whole, 10);
+  if ( negative ) *--end = '-';
+  return end;
+}
+
 // ######################################
 // ## Write Strings #####################
 // ######################################
 
-bool Genie::WriteStr(uint8_t index, const char *string) {
+uint16_t Genie::WriteStr(uint8_t index, const char *string) {
   if ( !displayDetected ) {
-    DoEvents();
+    poll_events();
     return 0;
   }
-  uint8_t checksum = 0, buffer[4+strlen(string)];
-  buffer[0] = GENIE_WRITE_STR;
-  buffer[1] = index;
-  buffer[2] = (uint8_t)strlen(string);
-  memmove(&buffer[3],&string[0],strlen(string));
-  for ( uint8_t i = 0; i < sizeof(buffer) - 1; i++ ) checksum ^= buffer[i];
-  buffer[sizeof(buffer) - 1] = checksum;
-
-  block_dequeue = 1; // disable dequeue
-  while ( pendingACK ) DoEvents(); // wait pending ACKs
-  writeMode(buffer,sizeof(buffer)); // write String
-  pendingACK = 1; // enable ACK check
-  pendingACK_timeout = millis(); // reset ACK check timer
-  while ( pendingACK ) DoEvents(); // wait pending ACKs
-  block_dequeue = 0; // re-enable dequeue
-
-  return 1;
+  poll_events();
+  uint8_t len = ( strlen(string) > 255 ) ? 255 : strlen(string);
+  return enqueue_payload_frame(GENIE_WRITE_STR, index, len, (const uint8_t*)string, len);
 }
 
-bool Genie::WriteStr(uint8_t index, String string) {
+uint16_t Genie::WriteStr(uint8_t index, String string) {
   return WriteStr(index, string.c_str());
 }
 
@@ -647,65 +1648,13 @@ uint16_t Genie::WriteStr(uint16_t index, const __FlashStringHelper *ifsh){
 #endif
 
 uint16_t Genie::WriteStr(uint16_t index, long n) { 
-	char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-	char *str = &buf[sizeof(buf) - 1];
-	
-	long N = n;
-	n = abs(n);
-
-	*str = '\0';
-
-	do {
-		unsigned long m = n;
-		n /= 10;
-		char c = m - 10 * n;
-		*--str = c < 10 ? c + '0' : c + 'A' - 10;
-	} while(n);
-	
-	if (N < 0) *--str = '-';
-	
-	return WriteStr(index, str);
+  return WriteStr(index, n, 10);
 }
 
 uint16_t Genie::WriteStr(uint16_t index, long n, int base) { 
-	char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-	char *str = &buf[sizeof(buf) - 1];
-	
-	long N;
-	*str = '\0';
-	if(n>=0) {
-		// prevent crash if called with base == 1
-		if (base < 2) base = 10;
-		if(base == 10) {
-			N = n;
-			n = abs(n);
-		}
-	
-		do {
-			unsigned long m = n;
-			n /= base;
-			char c = m - base * n;
-			*--str = c < 10 ? c + '0' : c + 'A' - 10;
-		} while(n);
-		
-		if(base == 10) {
-			if (N < 0) *--str = '-';
-		}
-			
-	}
-	
-	else if(n<0) {
-		unsigned long n2 = (unsigned long)n;
-		uint8_t base2 = base;
-		do {
-		unsigned long m = n2;
-		n2 /= base2;
-		char c = m - base2 * n2;
-		*--str = c < 10 ? c + '0' : c + 'A' - 10;
-		} while(n2);
-		
-	}
-    return WriteStr(index, str);
+  char buf[GENIE_NUMBER_SIZE];
+  buf[sizeof(buf) - 1] = '\0';
+  return WriteStr(index, genie_format_long(&buf[sizeof(buf) - 1], n, base));
 }
 
 uint16_t Genie::WriteStr(uint16_t index, int n) { 
@@ -717,37 +1666,13 @@ uint16_t Genie::WriteStr(uint16_t index, int n, int base) {
 }
 
 uint16_t Genie::WriteStr(uint16_t index, unsigned long n) { 
-	char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-	char *str = &buf[sizeof(buf) - 1];
-	
-	*str = '\0';
-
-	do {
-		unsigned long m = n;
-		n /= 10;
-		char c = m - 10 * n;
-		*--str = c < 10 ? c + '0' : c + 'A' - 10;
-	} while(n);
-	
-	return WriteStr(index, str);
+  return WriteStr(index, n, 10);
 }
 
 uint16_t Genie::WriteStr(uint16_t index, unsigned long n, int base) { 
-	char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-	char *str = &buf[sizeof(buf) - 1];
-	
-	*str = '\0';
-
-	// prevent crash if called with base == 1
-	if (base < 2) base = 10;
-	do {
-		unsigned long m = n;
-		n /= base;
-		char c = m - base * n;
-		*--str = c < 10 ? c + '0' : c + 'A' - 10;
-	} while(n);
-				
-    return WriteStr(index, str);
+  char buf[GENIE_NUMBER_SIZE];
+  buf[sizeof(buf) - 1] = '\0';
+  return WriteStr(index, genie_format_unsigned(&buf[sizeof(buf) - 1], n, base));
 }
 
 uint16_t Genie::WriteStr(uint16_t index, unsigned int n) { 
@@ -760,127 +1685,76 @@ uint16_t Genie::WriteStr(uint16_t index, unsigned n, int base) {
 
 
 uint16_t Genie::WriteStr(uint16_t index, double number, int digits) { 
-	char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-	char *str = &buf[sizeof(buf) - 1];
-	*str = '\0';  
-
-	double number2 = number;
-	if (number < 0.0) number = -number;
-
-	// Round correctly so that print(1.999, 2) prints as "2.00"
-	double rounding = 0.5;
-	for (int i=0; i<digits; ++i)
-	rounding /= 10.0;
-
-	number += rounding;
-
-	unsigned long int_part = (unsigned long)number;
-	double remainder = number - (double)int_part;
-
-	// Extract digits from the remainder one at a time
-	int digits2 = digits;
-	str = &buf[sizeof(buf) - 1 - digits2];
-	while (digits2-- > 0)
-	{
-	remainder *= 10.0;
-	int toPrint = int(remainder);
-	char c = toPrint + 48;
-	*str++ = c;
-	remainder -= toPrint; 
-	}
-	str = &buf[sizeof(buf) - 1 - digits];
-	if (digits > 0) *--str = '.';
-
-	// Extract the integer part of the number and print it  
-	do {
-	unsigned long m = int_part;
-	int_part /= 10;
-	char c = m - 10 * int_part;
-	*--str = c < 10 ? c + '0' : c + 'A' - 10;
-	} while(int_part);
-
-	// Handle negative numbers
-	if (number2 < 0.0) *--str = '-';
-
-	return WriteStr(index, str);
+  char buf[GENIE_NUMBER_SIZE];
+  buf[sizeof(buf) - 1] = '\0';
+  return WriteStr(index, genie_format_double(&buf[sizeof(buf) - 1], number, digits));
 }
 
 uint16_t Genie::WriteStr(uint16_t index, double n){
 	return WriteStr(index, n, 2);
 }
 
+uint16_t Genie::WriteStrFixed(uint8_t index, long value, uint8_t decimals, const char *suffix) {
+  return write_fixed(GENIE_WRITE_STR, index, value, decimals, suffix);
+}
+
+// Formats value straight into the frame payload, with suffix (units) appended
+// after it, so a length and its unit need no String or second buffer.
+uint16_t Genie::write_fixed(uint8_t cmd, uint8_t index, long value, uint8_t decimals, const char *suffix) {
+  if ( !displayDetected ) {
+    poll_events();
+    return 0;
+  }
+  poll_events();
+  uint8_t suffix_len = ( suffix == nullptr ) ? 0 : ( strlen(suffix) > 200 ) ? 200 : strlen(suffix);
+  char text[GENIE_NUMBER_SIZE + suffix_len];
+  char *end = &text[GENIE_NUMBER_SIZE];
+  if ( suffix_len ) memcpy(end, suffix, suffix_len);
+  char *str = genie_format_fixed(end, value, decimals);
+  uint8_t len = end + suffix_len - str;
+  return enqueue_payload_frame(cmd, index, len, (const uint8_t*)str, len);
+}
+
 /////////////////////// WriteStrU ////////////////////////
 //
 // Write a string to the display (Unicode)
 // Unicode characters are 2 bytes each
 //
 uint16_t Genie::WriteStrU (uint16_t index, uint16_t *string) {
+  if ( !displayDetected ) {
+    poll_events();
+    return 0;
+  }
   uint16_t *p;
-  unsigned int checksum = 0;
   int len = 0;
   p = string;
   while (*p++) len++;
-  if (len > 255) return -1;
+  if (len > 255) return 0;
 
-  uint8_t buffer[4+(len*2)];
-  buffer[0] = GENIE_WRITE_STRU;
-  buffer[1] = (uint8_t)index;
-  buffer[2] = (uint8_t)(len);
-  for ( uint8_t i = 0; i < 3; i++ ) checksum ^= buffer[i];
-
-  p = string;
-  int run = 2;
-
-  while (*p) {
-    run++;
-    buffer[run] = (*p >> 8);
-    checksum ^= *p >> 8;
-    run++;
-    buffer[run] = (*p);
-    checksum ^= *p++ & 0xff;
-  }
-  buffer[(4+(len*2))-1] = checksum;
-
-  block_dequeue = 1; // disable dequeue
-  while ( pendingACK ) DoEvents(); // wait pending ACKs
-  writeMode(buffer,sizeof(buffer)); // write String
-  pendingACK = 1; // enable ACK check
-  pendingACK_timeout = millis(); // reset ACK check timer
-  while ( pendingACK ) DoEvents(); // wait pending ACKs
-  block_dequeue = 0; // re-enable dequeue
-
-  return 1;
+  uint8_t buffer[len*2];
+  for ( int i = 0; i < len; i++ ) {
+    buffer[2*i] = string[i] >> 8;
+    buffer[2*i+1] = (uint8_t)string[i];
+  }
+  poll_events();
+  return enqueue_payload_frame(GENIE_WRITE_STRU, (uint8_t)index, (uint8_t)len, buffer, sizeof(buffer));
 }
 
 // ######################################
 // ## Write WriteInhLabel Strings #######
 // ######################################
 
-bool Genie::WriteInhLabel(uint8_t index, const char *string) {
+uint16_t Genie::WriteInhLabel(uint8_t index, const char *string) {
   if ( !displayDetected ) {
-    DoEvents();
+    poll_events();
     return 0;
   }
-  uint8_t checksum = 0, buffer[4+strlen(string)];
-  buffer[0] = GENIE_WRITE_INH_LABEL;
-  buffer[1] = index;
-  buffer[2] = (uint8_t)strlen(string);
-  memmove(&buffer[3],&string[0],strlen(string));
-  for ( uint8_t i = 0; i < sizeof(buffer) - 1; i++ ) checksum ^= buffer[i];
-  buffer[sizeof(buffer) - 1] = checksum;
-
-  block_dequeue = 1; // disable dequeue
-  while ( pendingACK ) DoEvents(); // wait pending ACKs
-  writeMode(buffer,sizeof(buffer)); // write String
-  pendingACK = 1; // enable ACK check
-  pendingACK_timeout = millis(); // reset ACK check timer
-  while ( pendingACK ) DoEvents(); // wait pending ACKs
-  block_dequeue = 0; // re-enable dequeue
-
-  return 1;
+  poll_events();
+  uint8_t len = ( strlen(string) > 255 ) ? 255 : strlen(string);
+  return enqueue_payload_frame(GENIE_WRITE_INH_LABEL, index, len, (const uint8_t*)string, len);
 }
 
-bool Genie::WriteInhLabel(uint8_t index, String string) {
+uint16_t Genie::WriteInhLabel(uint8_t index, String string) {
   return WriteInhLabel(index, string.c_str());
 }
 
@@ -897,24 +1771,7 @@ uint16_t Genie::WriteInhLabel (uint16_t index) {
 // ######################################
 
 uint16_t Genie::WriteInhLabel (uint16_t index, long n) { 
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
-  
-  long N = n;
-  n = abs(n);
-
-  *str = '\0';
-
-  do {
-    unsigned long m = n;
-    n /= 10;
-    char c = m - 10 * n;
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while(n);
-  
-  if (N < 0) *--str = '-';
-  
-  return WriteInhLabel(index, str);
+  return WriteInhLabel(index, n, 10);
 }
 
 // ######################################
@@ -922,41 +1779,9 @@ uint16_t Genie::WriteInhLabel (uint16_t index, long n) {
 // ######################################
 
 uint16_t Genie::WriteInhLabel (uint16_t index, long n, int base) { 
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
-  
-  long N;
-  *str = '\0';
-  if(n>=0) {
-    // prevent crash if called with base == 1
-    if (base < 2) base = 10;
-    if(base == 10) {
-      N = n;
-      n = abs(n);
-    }
-    do {
-      unsigned long m = n;
-      n /= base;
-      char c = m - base * n;
-      *--str = c < 10 ? c + '0' : c + 'A' - 10;
-    } while(n);
-
-    if(base == 10) {
-      if (N < 0) *--str = '-';
-    }
-  }
-  
-  else if(n<0) {
-    unsigned long n2 = (unsigned long)n;
-    uint8_t base2 = base;
-    do {
-    unsigned long m = n2;
-    n2 /= base2;
-    char c = m - base2 * n2;
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-    } while(n2);
-  }
-  return WriteInhLabel(index, str);
+  char buf[GENIE_NUMBER_SIZE];
+  buf[sizeof(buf) - 1] = '\0';
+  return WriteInhLabel(index, genie_format_long(&buf[sizeof(buf) - 1], n, base));
 }
 
 // ######################################
@@ -980,19 +1805,7 @@ uint16_t Genie::WriteInhLabel (uint16_t index, int n, int base) {
 // ######################################
 
 uint16_t Genie::WriteInhLabel (uint16_t index, unsigned long n) { 
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
-  
-  *str = '\0';
-
-  do {
-    unsigned long m = n;
-    n /= 10;
-    char c = m - 10 * n;
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while(n);
-  
-  return WriteInhLabel(index, str);
+  return WriteInhLabel(index, n, 10);
 }
 
 // ######################################
@@ -1000,21 +1813,9 @@ uint16_t Genie::WriteInhLabel (uint16_t index, unsigned long n) {
 // ######################################
 
 uint16_t Genie::WriteInhLabel (uint16_t index, unsigned long n, int base) { 
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
-  
-  *str = '\0';
-
-  // prevent crash if called with base == 1
-  if (base < 2) base = 10;
-  do {
-    unsigned long m = n;
-    n /= base;
-    char c = m - base * n;
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while(n);
-        
-  return WriteInhLabel(index, str);
+  char buf[GENIE_NUMBER_SIZE];
+  buf[sizeof(buf) - 1] = '\0';
+  return WriteInhLabel(index, genie_format_unsigned(&buf[sizeof(buf) - 1], n, base));
 }
 
 uint16_t Genie::WriteInhLabel (uint16_t index, unsigned int n) { 
@@ -1032,47 +1833,17 @@ uint16_t Genie::WriteInhLabel (uint16_t index, unsigned n, int base) {
 // ######################################
 
 uint16_t Genie::WriteInhLabel (uint16_t index, double number, int digits) {
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
-  *str = '\0';
-
-  double number2 = number;
-  if (number < 0.0) number = -number;
-
-  // Round correctly so that print(1.999, 2) prints as "2.00"
-  double rounding = 0.5;
-  for (int i = 0; i < digits; ++i) rounding /= 10.0;
-
-  number += rounding;
-
-  unsigned long int_part = (unsigned long)number;
-  double remainder = number - (double)int_part;
-
-  // Extract digits from the remainder one at a time
-  int digits2 = digits;
-  str = &buf[sizeof(buf) - 1 - digits2];
-  while (digits2-- > 0) {
-    remainder *= 10.0;
-    int toPrint = int(remainder);
-    char c = toPrint + 48;
-    *str++ = c;
-    remainder -= toPrint;
-  }
-  str = &buf[sizeof(buf) - 1 - digits];
-  if (digits > 0) *--str = '.';
-
-  // Extract the integer part of the number and print it
-  do {
-    unsigned long m = int_part;
-    int_part /= 10;
-    char c = m - 10 * int_part;
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while (int_part);
+  char buf[GENIE_NUMBER_SIZE];
+  buf[sizeof(buf) - 1] = '\0';
+  return WriteInhLabel(index, genie_format_double(&buf[sizeof(buf) - 1], number, digits));
+}
 
-  // Handle negative numbers
-  if (number2 < 0.0) *--str = '-';
+// ######################################
+// ## Write WriteInhLabel Fixed Point ###
+// ######################################
 
-  return WriteInhLabel(index, str);
+uint16_t Genie::WriteInhLabelFixed(uint8_t index, long value, uint8_t decimals, const char *suffix) {
+  return write_fixed(GENIE_WRITE_INH_LABEL, index, value, decimals, suffix);
 }
 
 // ######################################
@@ -1109,109 +1880,84 @@ uint16_t Genie::GetEventData(genieFrame * e) {
   return (e->reportObject.data_msb << 8) + e->reportObject.data_lsb;
 }
 
+#if GENIE_MAGIC_SUPPORT
 // ######################################
 // ## Write Magic Bytes #################
 // ######################################
 
-int8_t Genie::WriteMagicBytes(uint8_t index, uint8_t *bytes, uint8_t len, uint8_t report) {
+uint16_t Genie::WriteMagicBytes(uint8_t index, uint8_t *bytes, uint8_t len) {
   if ( !displayDetected ) {
-    DoEvents();
-    return -1;
-  }
-  uint8_t checksum = 0, buffer[4 + len];
-  buffer[0] = GENIEM_WRITE_BYTES;
-  buffer[1] = index;
-  buffer[2] = len;
-  memmove(&buffer[3], bytes, len);
-  for ( uint8_t i = 0; i < sizeof(buffer) - 1; i++ ) checksum ^= buffer[i];
-  buffer[sizeof(buffer) - 1] = checksum;
-
-  block_dequeue = 1;
-  while ( pendingACK ) DoEvents();
-  writeMode(buffer, sizeof(buffer));
-
-  if ( report ) {
-    while ( pendingACK ) DoEvents();
-    block_dequeue = 0;
-    return 1;
-  }
-
-  uint32_t timeout = millis();
-  while (millis() - timeout < 1000) {
-    uint8_t result = DoEvents();
-    switch ( result ) {
-      case GENIEM_REPORT_BYTES: {
-          block_dequeue = 0;
-          return result;
-        }
-      case GENIE_ACK: {
-          block_dequeue = 0;
-          return result;
-        }
-      case GENIE_NAK: {
-          block_dequeue = 0;
-          return result;
-        }
-    }
+    poll_events();
+    return 0;
   }
-  block_dequeue = 0;
-  return -1;
+  poll_events();
+  return enqueue_payload_frame(GENIEM_WRITE_BYTES, index, len, bytes, len);
 }
 
 // ######################################
 // ## Write Magic Double Bytes ##########
 // ######################################
 
-int8_t Genie::WriteMagicDBytes(uint8_t index, uint16_t *shorts, uint8_t len, uint8_t report) {
+uint16_t Genie::WriteMagicDBytes(uint8_t index, uint16_t *shorts, uint8_t len) {
   if ( !displayDetected ) {
-    DoEvents();
-    return -1;
+    poll_events();
+    return 0;
   }
-  uint8_t checksum = 0, buffer[4+len*2];
-  buffer[0] = GENIEM_WRITE_DBYTES;
-  buffer[1] = index;
-  buffer[2] = len;
-  bool odd_or_even = ( len % 2 );
-  for ( uint16_t i = 0, j = 0; i < len; i++ ) {
-    buffer[j+3] = shorts[i] >> 8;
-    buffer[j+4] = (uint8_t)shorts[i];
-    j+=2;
+  uint8_t buffer[len*2];
+  for ( uint16_t i = 0; i < len; i++ ) {
+    buffer[2*i] = shorts[i] >> 8;
+    buffer[2*i+1] = (uint8_t)shorts[i];
   }
-  if ( odd_or_even ) buffer[sizeof(buffer)-1] = shorts[len-2];
-  for ( uint8_t i = 0; i < sizeof(buffer) - 1; i++ ) checksum ^= buffer[i];
-  buffer[sizeof(buffer) - 1] = checksum;
-
-  block_dequeue = 1;
-  while ( pendingACK ) DoEvents();
-  writeMode(buffer, sizeof(buffer));
+  poll_events();
+  return enqueue_payload_frame(GENIEM_WRITE_DBYTES, index, len, buffer, sizeof(buffer));
+}
 
-  if ( report ) {
-    block_dequeue = 0;
-    while ( pendingACK ) DoEvents();
-    return 1;
+// ######################################
+// ## Write Objects (batched) ###########
+// ######################################
+// Sends the writes the display does not already show to MagicObject index, packed as
+// double bytes ((object << 8) | index, value), GENIE_BATCH_MAX writes per frame.
+// Returns the ticket of the last frame, GENIE_TICKET_UNCHANGED if nothing was sent,
+// 0 on queue overflow or while offline.
+uint16_t Genie::WriteObjects(uint8_t index, const GenieWrite *writes, uint8_t count) {
+  for ( uint8_t i = 0; i < count; i++ ) shadow_mirror(writes[i].object, writes[i].index, writes[i].value);
+  if ( !displayDetected ) {
+    poll_events();
+    return 0;
   }
-
-  uint32_t timeout = millis();
-  while (millis() - timeout < 1000) {
-    uint8_t result = DoEvents();
-    switch ( result ) {
-      case GENIEM_REPORT_BYTES: {
-          block_dequeue = 0;
-          return result;
-        }
-      case GENIE_ACK: {
-          block_dequeue = 0;
-          return result;
-        }
-      case GENIE_NAK: {
-          block_dequeue = 0;
-          return result;
-        }
+  poll_events();
+  uint8_t payload[4 * GENIE_BATCH_MAX];
+  uint8_t packed = 0;
+  uint16_t ticket = 0;
+  for ( uint16_t i = 0; i <= count; i++ ) {
+    if ( i < count ) {
+      if ( shadow_redundant(writes[i].object, writes[i].index, writes[i].value) ) continue;
+      uint8_t queued[7] = { 0, GENIE_WRITE_OBJ, writes[i].object, writes[i].index, 0, 0, 0 };
+      _outgoing_priority.findRemove<1,2,3>(queued,7); /* superseded by this batch */
+      _outgoing_queue.findRemove<1,2,3>(queued,7);
+      payload[4*packed] = writes[i].object;
+      payload[4*packed+1] = writes[i].index;
+      payload[4*packed+2] = writes[i].value >> 8;
+      payload[4*packed+3] = (uint8_t)writes[i].value;
+      if ( ++packed < GENIE_BATCH_MAX ) continue;
     }
+    if ( !packed ) break;
+    ticket = enqueue_payload_frame(GENIE_WRITE_BATCH, index, 2 * packed, payload, 4 * packed);
+    if ( !ticket ) return 0;
+    for ( uint8_t j = 0; j < packed; j++ ) { /* pending until the frame is answered, see shadow_settle() */
+      if ( !shadow_enabled(payload[4*j]) ) continue;
+      GenieShadowEntry *entry = shadow_find(payload[4*j], payload[4*j+1], 1);
+      if ( entry == nullptr ) continue;
+      entry->value = ((uint16_t)payload[4*j+2] << 8) | payload[4*j+3];
+      entry->valid = 0;
+      entry->batch = ticket;
+    }
+    packed = 0;
   }
-  block_dequeue = 0;
-  return -1;
+  if ( !ticket ) return GENIE_TICKET_UNCHANGED; /* the display already shows every value, no status slot taken */
+  return ticket;
 }
+#endif
 
 
 
@@ -1235,6 +1981,22 @@ int32_t GenieObject::read(bool state) {
   return instance->ReadObject(object, index, state);
 }
 
+int32_t GenieObject::refresh() {
+  return instance->RefreshObject(object, index);
+}
+
+uint32_t GenieObject::updated() {
+  return instance->GetMirrorTime(object, index);
+}
+
+uint16_t GenieObject::readAsync(UserReadPtr callback) {
+  return instance->ReadObjectAsync(object, index, callback);
+}
+
+uint16_t GenieObject::readAsync(UserReadContextPtr callback, void *context) {
+  return instance->ReadObjectAsync(object, index, callback, context);
+}
+
 // ######################################
 // ## GenieObject write #################
 // ######################################
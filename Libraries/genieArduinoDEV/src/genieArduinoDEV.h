@@ -53,15 +53,22 @@
 #include "genie_buffer.h"
 #include <stdint.h>
 
-#define GENIE_SS_SUPPORT !defined(ARDUINO_ARCH_SAM) \
-                      && !defined(ARDUINO_ARCH_SAMD) \
-                      && !defined(ARDUINO_ARCH_RP2040) \
-                      && !defined(ESP32) \
-                      && !defined(ESP8266)
+#ifndef GENIE_SS_SUPPORT
+#if defined(ARDUINO_ARCH_SAM) \
+    || defined(ARDUINO_ARCH_SAMD) \
+    || defined(ARDUINO_ARCH_RP2040) \
+    || defined(ESP32) \
+    || defined(ESP8266) \
+    || defined(GENIE_HOST)
                       // This lists the known board families that
                       // don't support SoftwareSerial.
                       // If you add to this list, please contact us
                       // to gain official support in the library.
+#define GENIE_SS_SUPPORT 0
+#else
+#define GENIE_SS_SUPPORT 1 // 0 leaves SoftwareSerial out on boards that have it
+#endif
+#endif
 
 #if GENIE_SS_SUPPORT
 #include <SoftwareSerial.h>
@@ -72,6 +79,29 @@
 
 #define GENIE_VERSION    "GenieArduino 2022"   // DD-MM-YYYY
 
+// Build configuration. The library sources must see the same values as the
+// sketch, so set these as compiler flags for the whole build (for example
+// build_flags in platformio.ini), not with #define in the sketch.
+//
+// Messages sent to AttachDebugStream() above GENIE_LOG_LEVEL are compiled
+// out, their strings and checks included.
+
+#define GENIE_LOG_NONE          0
+#define GENIE_LOG_ERROR         1 // lost frames, events or reads, link faults
+#define GENIE_LOG_INFO          2 // display online, recovered, misuse of the magic readers
+#define GENIE_LOG_DEBUG         3 // every ACK, ping and magic report
+
+#ifndef GENIE_LOG_LEVEL
+#define GENIE_LOG_LEVEL         GENIE_LOG_DEBUG
+#endif
+
+// 0 drops the magic byte API, WriteObjects() and the GENIE_MAGIC_BUFFER_SIZE
+// receive buffer. Magic reports from the display are then skipped.
+
+#ifndef GENIE_MAGIC_SUPPORT
+#define GENIE_MAGIC_SUPPORT     1
+#endif
+
 // Genie commands & replys:
 
 #define GENIE_ACK               0x06
@@ -176,8 +206,110 @@
 // Do not modify current values. Recommended settings.
 
 
-#define DISPLAY_TIMEOUT         3000
-#define AUTO_PING_CYCLE         1250
+#define DISPLAY_TIMEOUT         3000 // ms without a valid frame before the display is considered disconnected
+#define AUTO_PING_CYCLE         1250 // ms without a valid frame before the display is pinged
+#define GENIE_BAUD_PROBE_TIME   300  // ms spent pinging at each candidate baud rate
+
+// Completion states for queued variable length writes (strings, labels,
+// magic bytes), see GetWriteStatus()
+
+#define GENIE_TX_UNKNOWN        0 // ticket not tracked (expired or invalid)
+#define GENIE_TX_QUEUED         1
+#define GENIE_TX_SENT           2
+#define GENIE_TX_ACKED          3
+#define GENIE_TX_NAKED          4
+#define GENIE_TX_TIMEOUT        5
+#define GENIE_TX_DROPPED        6 // discarded on queue overflow
+
+// Bytes shared by all queued variable length payloads, rounded up to a power of 2.
+// Frames larger than this are still written directly (blocking).
+
+#ifndef GENIE_PAYLOAD_BUFFER_SIZE
+#ifdef AVR
+#define GENIE_PAYLOAD_BUFFER_SIZE 64
+#else
+#define GENIE_PAYLOAD_BUFFER_SIZE 256
+#endif
+#endif
+
+// Most recent tickets whose state GetWriteStatus() still knows. MUST be a power of 2
+
+#ifndef GENIE_TX_TRACKED
+#ifdef AVR
+#define GENIE_TX_TRACKED        8
+#else
+#define GENIE_TX_TRACKED        16
+#endif
+#endif
+
+#define GENIE_TICKET_UNCHANGED  0xFFFF // WriteObjects() had nothing to send, always reads GENIE_TX_ACKED
+
+// A frame answered with a NAK, or not answered, is sent again up to GENIE_TX_RETRIES
+// times before it fails. Widget writes wait for their ACK for the measured round trip
+// plus four times its deviation, kept between GENIE_ACK_TIMEOUT_MIN and GENIE_ACK_TIMEOUT.
+// Strings, magic bytes and form changes always get GENIE_ACK_TIMEOUT.
+
+#ifndef GENIE_TX_RETRIES
+#define GENIE_TX_RETRIES        3
+#endif
+
+#define GENIE_ACK_TIMEOUT       500 // ms
+#ifndef GENIE_ACK_TIMEOUT_MIN
+#define GENIE_ACK_TIMEOUT_MIN   30  // ms
+#endif
+
+// ReadObjectAsync() requests that can be outstanding at once, and how long a
+// sent request waits for its report, see GetReadStatus()
+
+#ifndef GENIE_READS_TRACKED
+#ifdef AVR
+#define GENIE_READS_TRACKED     2
+#else
+#define GENIE_READS_TRACKED     8
+#endif
+#endif
+
+#define GENIE_READ_TIMEOUT      100 // ms, as ReadObject(object, index, true)
+
+// Bytes of a received magic byte/double byte report held for the byte readers until
+// its checksum arrives. Larger reports are dropped. 0 leaves the buffer out, for
+// sketches that receive reports with AttachMagicReceiver() only.
+
+#ifndef GENIE_MAGIC_BUFFER_SIZE
+#ifdef AVR
+#define GENIE_MAGIC_BUFFER_SIZE 64
+#else
+#define GENIE_MAGIC_BUFFER_SIZE 128
+#endif
+#endif
+
+#define GENIE_RX_TIMEOUT        100 // ms between bytes before a partial frame is abandoned
+
+// Stack buffer for one formatted number (a long in base 2, sign and terminator),
+// and the most decimals WriteStr(index, double, digits) and the Fixed writes print.
+
+#define GENIE_NUMBER_SIZE       (8 * sizeof(long) + 2)
+#define GENIE_FIXED_DECIMALS_MAX 9
+
+// Widget writes packed into one GENIEM_WRITE_DBYTES frame by WriteObjects(), 4 bytes
+// each. The display holds at most 80 command bytes (CMDLenMAX), frame header included.
+
+#ifndef GENIE_BATCH_MAX
+#define GENIE_BATCH_MAX         16
+#endif
+
+#define GENIE_WRITE_BATCH       0x90 // outgoing queue only, sent as GENIEM_WRITE_DBYTES
+
+// Number of (object, index) pairs whose last acknowledged value is kept, so
+// writing the value the display already shows is skipped. MUST be a power of 2
+
+#ifndef GENIE_SHADOW_SIZE
+#ifdef AVR
+#define GENIE_SHADOW_SIZE 4
+#else
+#define GENIE_SHADOW_SIZE 16
+#endif
+#endif
 
 
 // Structure to store replys returned from a display
@@ -222,18 +354,122 @@ union genieFrame {
   FrameReportObj  reportObject;
 };
 
-#define MAX_GENIE_EVENTS    16      // MUST be a power of 2
+#ifndef MAX_GENIE_EVENTS
+#define MAX_GENIE_EVENTS    16      // rounded up to a power of 2
+#endif
+
+// Outgoing lanes for widget writes, see SetWritePriority(). The high priority lane
+// is always sent first, but a waiting low priority frame gets a turn after
+// GENIE_PRIORITY_BURST high priority frames in a row.
+
+#define GENIE_PRIORITY_LOW      0 // widget values, strings, reads and everything else
+#define GENIE_PRIORITY_HIGH     1 // safety and state, forms and indicator LEDs by default
+
+#ifndef GENIE_PRIORITY_FRAMES
+#define GENIE_PRIORITY_FRAMES   8 // high priority lane size, rounded up to a power of 2
+#endif
+
+#ifndef GENIE_PRIORITY_BURST
+#define GENIE_PRIORITY_BURST    4
+#endif
+
+// How received events of an object type are queued, see SetEventPolicy()
+
+#define GENIE_EVENT_COALESCE    0 // a newer event replaces the one queued for the same widget
+#define GENIE_EVENT_APPEND      1 // every event is queued, in order
+
+// Where ReadObject(object, index, 1) gets the value of an object type, see SetReadPolicy()
+
+#define GENIE_READ_DISPLAY      0 // asks the display every time
+#define GENIE_READ_MIRROR       1 // last value reported by the display or acknowledged for a write, the display is only asked while unknown
+
+// Event queue slots coalescing events may not fill, kept for appended events
+// (keystrokes, button presses), read replies and library status events.
+
+#ifndef GENIE_EVENT_RESERVE
+#define GENIE_EVENT_RESERVE     (MAX_GENIE_EVENTS / 2)
+#endif
+
+// Latency histogram: bucket 0 counts samples under 256us, bucket n samples
+// under 256us << n, the last bucket everything above.
+
+#define GENIE_LATENCY_BUCKETS   12
+
+struct GenieLatencyStats {
+  uint32_t  count = 0;
+  uint32_t  min = 0; // us
+  uint32_t  max = 0; // us
+  uint64_t  total = 0; // us
+  uint16_t  histogram[GENIE_LATENCY_BUCKETS] = { 0 }; // saturates at 65535
+  uint32_t  mean() const { return count ? total / count : 0; }
+};
+
+struct GenieLinkStats {
+  GenieLatencyStats ping; // form ping sent to form report received, Ping() and auto pings
+  GenieLatencyStats ack; // frame sent to ACK received
+  uint32_t  acks = 0;
+  uint32_t  naks = 0;
+  uint32_t  ack_timeouts = 0;
+  uint32_t  retries = 0; // frames sent again after a NAK or an ACK timeout
+  uint16_t  tx_queue_high = 0; // most frames waiting in the outgoing queue
+  uint16_t  rx_queue_high = 0; // most events waiting for the event handler
+  uint16_t  payload_high = 0; // most bytes waiting in the outgoing payload buffer
+  uint32_t  events_dropped = 0; // received events lost to a full event queue
+};
+
+struct GenieShadowEntry {
+  uint8_t   object;
+  uint8_t   index;
+  uint16_t  value;
+  bool      used = 0;
+  bool      valid = 0; // value is known to be shown on the display
+  uint16_t  batch = 0; // ticket of the queued batch frame carrying value, 0 = none
+  uint16_t  written = 0; // last value the sketch wrote, replayed after a reconnect
+  bool      wrote = 0; // written holds a value, entries made by reports alone are not replayed
+  uint32_t  updated = 0; // millis() when value was last reported or acknowledged
+};
 
-struct EventQueueStruct {
-  genieFrame  frames[MAX_GENIE_EVENTS];
-  uint8_t     rd_index = 0;
-  uint8_t     wr_index = 0;
-  uint8_t     n_events = 0;
+struct GenieWrite {
+  uint8_t   object;
+  uint8_t   index;
+  uint16_t  value;
 };
 
+class Genie;
+
 typedef void  (*UserEventHandlerPtr) (void);
+typedef void  (*UserEventContextPtr)(Genie &genie, void *context); // the instance that has events queued, and the context given to AttachEventHandler
+typedef void  (*UserConnectionPtr)(bool online); // called from DoEvents when the display comes online or goes offline
+typedef void  (*UserConnectionContextPtr)(Genie &genie, bool online, void *context);
 typedef void  (*UserBytePtr)(uint8_t, uint8_t);
 typedef void  (*UserDoubleBytePtr)(uint8_t, uint8_t);
+typedef void  (*UserMagicPtr)(uint8_t index, uint8_t *bytes, uint16_t len, bool dbytes); // len in bytes, double bytes msb first
+typedef void  (*UserReadPtr)(uint8_t object, uint8_t index, int32_t value); // value is -1 if the read failed
+typedef void  (*UserByteContextPtr)(Genie &genie, uint8_t index, uint8_t len, void *context);
+typedef void  (*UserDoubleByteContextPtr)(Genie &genie, uint8_t index, uint8_t len, void *context);
+typedef void  (*UserMagicContextPtr)(Genie &genie, uint8_t index, uint8_t *bytes, uint16_t len, bool dbytes, void *context);
+typedef void  (*UserReadContextPtr)(Genie &genie, uint8_t object, uint8_t index, int32_t value, void *context);
+
+struct GenieReadRequest {
+  uint16_t    handle = 0; // 0 = slot never used
+  uint8_t     object;
+  uint8_t     index;
+  uint8_t     status = GENIE_TX_UNKNOWN; // GENIE_TX_QUEUED, SENT, then ACKED (answered), TIMEOUT or DROPPED
+  bool        notify = 0; // finished, callback not run yet
+  uint16_t    value;
+  uint32_t    sent; // millis() when the GENIE_READ_OBJ frame went out
+  UserReadPtr callback;
+  UserReadContextPtr context_callback; // called instead of callback when set
+  void*       context;
+};
+
+// Allocation free number formatting used by the numeric WriteStr and WriteInhLabel
+// overloads. Each writes backwards, ending just before end, and returns the first
+// character. See README.md for the sizes needed.
+char*         genie_format_unsigned       (char *end, unsigned long n, int base = 10);
+char*         genie_format_long           (char *end, long n, int base = 10);
+char*         genie_format_fixed          (char *end, long value, uint8_t decimals);
+char*         genie_format_double         (char *end, double number, int digits);
 
 /////////////////////////////////////////////////////////////////////
 // User API functions
@@ -241,27 +477,46 @@ typedef void  (*UserDoubleBytePtr)(uint8_t, uint8_t);
 //
 class Genie {
   public:
-    Genie_Buffer < uint8_t, (uint32_t)pow(2, ceil(log(MAX_GENIE_EVENTS) / log(2))), 6 > _incomming_queue; /* currentForm, cmd, object, index, data1, data2 */
-    Genie_Buffer < uint8_t, (uint32_t)pow(2, ceil(log(MAX_GENIE_EVENTS) / log(2))), 7 > _outgoing_queue; /* currentForm, cmd, object, index, data1, data2, crc */
+    Genie_Frame_Buffer < uint8_t, genie_ring_size(MAX_GENIE_EVENTS), 6, 0, 1, 2 > _incomming_queue; /* cmd, object, index, data1, data2, crc -- keyed on cmd, object, index */
+    Genie_Frame_Buffer < uint8_t, genie_ring_size(MAX_GENIE_EVENTS), 7, 1, 2, 3 > _outgoing_queue; /* currentForm, cmd, object, index, data1, data2, crc -- keyed on cmd, object, index */
+    Genie_Frame_Buffer < uint8_t, genie_ring_size(GENIE_PRIORITY_FRAMES), 7, 1, 2, 3 > _outgoing_priority; /* high priority GENIE_WRITE_OBJ frames, same layout */
     Genie                                     ();
 #if GENIE_SS_SUPPORT
     bool          Begin                       (SoftwareSerial &serial);
 #endif
     bool          Begin                       (HardwareSerial &serial);
+    bool          Begin                       (HardwareSerial &serial, const uint32_t *bauds, uint8_t count);
     bool          Begin                       (Stream &serial, uint16_t txDelay = 0);
+#if GENIE_SS_SUPPORT
+    void          BeginAsync                  (SoftwareSerial &serial);
+#endif
+    void          BeginAsync                  (HardwareSerial &serial);
+    void          BeginAsync                  (HardwareSerial &serial, const uint32_t *bauds, uint8_t count);
+    void          BeginAsync                  (Stream &serial, uint16_t txDelay = 0);
+    uint32_t      GetBaudRate                 ();
+    const GenieLinkStats& GetLinkStats        ();
+    void          ResetLinkStats              ();
+    uint16_t      GetAckTimeout               ();
     void          AttachDebugStream           (Stream &serial);
     bool          IsOnline                    ();
     int16_t       GetForm                     ();
     void          SetForm                     (uint8_t newForm);
     void          SetRecoveryInterval         (uint8_t pulses);
+    void          SetLinkTimeouts             (uint16_t idle, uint16_t timeout);
     int32_t       ReadObject                  (uint8_t object, uint8_t index, bool now = 0);
+    int32_t       RefreshObject               (uint8_t object, uint8_t index);
+    uint32_t      GetMirrorTime               (uint8_t object, uint8_t index);
+    uint16_t      ReadObjectAsync             (uint8_t object, uint8_t index, UserReadPtr callback = nullptr);
+    uint16_t      ReadObjectAsync             (uint8_t object, uint8_t index, UserReadContextPtr callback, void *context);
+    uint8_t       GetReadStatus               (uint16_t handle);
+    int32_t       GetReadValue                (uint16_t handle);
     bool          WriteObject                 (uint8_t object, uint8_t index, uint16_t data);
     uint16_t      WriteIntLedDigits           (uint16_t index, int16_t data);
     uint16_t      WriteIntLedDigits           (uint16_t index, float data);
     uint16_t      WriteIntLedDigits           (uint16_t index, int32_t data);
     bool          WriteContrast               (uint8_t value);
-    bool          WriteStr                    (uint8_t index, const char *string);
-    bool          WriteStr                    (uint8_t index, String string);
+    uint16_t      WriteStr                    (uint8_t index, const char *string);
+    uint16_t      WriteStr                    (uint8_t index, String string);
     uint16_t      WriteStr                    (uint16_t index, long n) ;
     uint16_t      WriteStr                    (uint16_t index, long n, int base) ;
     uint16_t      WriteStr                    (uint16_t index, unsigned long n) ;
@@ -275,9 +530,10 @@ class Genie {
 #endif
     uint16_t      WriteStr                    (uint16_t index, double n, int digits);
     uint16_t      WriteStr                    (uint16_t index, double n);
+    uint16_t      WriteStrFixed               (uint8_t index, long value, uint8_t decimals, const char *suffix = nullptr);
     uint16_t      WriteStrU                   (uint16_t index, uint16_t *string);
-    bool          WriteInhLabel               (uint8_t index, const char *string);
-    bool          WriteInhLabel               (uint8_t index, String string);
+    uint16_t      WriteInhLabel               (uint8_t index, const char *string);
+    uint16_t      WriteInhLabel               (uint8_t index, String string);
     uint16_t      WriteInhLabel               (uint16_t index);
     uint16_t      WriteInhLabel               (uint16_t index, long n) ;
     uint16_t      WriteInhLabel               (uint16_t index, long n, int base) ;
@@ -288,6 +544,7 @@ class Genie {
     uint16_t      WriteInhLabel               (uint16_t index, unsigned int n) ;
     uint16_t      WriteInhLabel               (uint16_t index, unsigned int n, int base) ;
     uint16_t      WriteInhLabel               (uint16_t index, double n, int digits = 2);
+    uint16_t      WriteInhLabelFixed          (uint8_t index, long value, uint8_t decimals, const char *suffix = nullptr);
 #ifdef AVR
     uint16_t      WriteInhLabel               (uint16_t index, const __FlashStringHelper *ifsh);
 #endif
@@ -297,35 +554,161 @@ class Genie {
     int16_t       DoEvents                    ();
     void          Ping                        (uint16_t interval);
     void          AttachEventHandler          (UserEventHandlerPtr userHandler);
+    void          AttachEventHandler          (UserEventContextPtr userHandler, void *context);
+    void          AttachConnectionHandler     (UserConnectionPtr userHandler);
+    void          AttachConnectionHandler     (UserConnectionContextPtr userHandler, void *context);
+#if GENIE_MAGIC_SUPPORT
     void          AttachMagicByteReader       (UserBytePtr userHandler);
+    void          AttachMagicByteReader       (UserByteContextPtr userHandler, void *context);
     void          AttachMagicDoubleByteReader (UserDoubleBytePtr userHandler);
+    void          AttachMagicDoubleByteReader (UserDoubleByteContextPtr userHandler, void *context);
+    void          AttachMagicReceiver         (uint8_t *buffer, uint16_t size, UserMagicPtr userHandler);
+    void          AttachMagicReceiver         (uint8_t *buffer, uint16_t size, UserMagicContextPtr userHandler, void *context);
+#endif
+    void          SetEventPolicy              (uint8_t object, uint8_t policy);
+    uint8_t       GetEventPolicy              (uint8_t object);
+    void          SetWritePriority            (uint8_t object, uint8_t priority);
+    uint8_t       GetWritePriority            (uint8_t object);
+    void          SetReadPolicy               (uint8_t object, uint8_t policy);
+    uint8_t       GetReadPolicy               (uint8_t object);
     uint32_t      GetUptime                   ();
+    uint8_t       GetWriteStatus              (uint16_t ticket);
 
     // Genie Magic functions (ViSi-Genie Pro Only)
 
-    int8_t        WriteMagicBytes             (uint8_t index, uint8_t *bytes, uint8_t len, uint8_t report = 0);
-    int8_t        WriteMagicDBytes            (uint8_t index, uint16_t *bytes, uint8_t len, uint8_t report = 0);
+#if GENIE_MAGIC_SUPPORT
+    uint16_t      WriteMagicBytes             (uint8_t index, uint8_t *bytes, uint8_t len);
+    uint16_t      WriteMagicDBytes            (uint8_t index, uint16_t *bytes, uint8_t len);
+    uint16_t      WriteObjects                (uint8_t index, const GenieWrite *writes, uint8_t count);
     int16_t       GetNextByte                 ();
     int32_t       GetNextDoubleByte           ();
+#endif
 
   protected:
   private:
-    //////////////////////////////////////////////////////////////
-    // A structure to hold up to MAX_GENIE_EVENTS events receive
-    // from the display
-    //
-    EventQueueStruct EventQueue;
-
     Stream* deviceSerial;
     Stream* debugSerial;
 
     UserEventHandlerPtr UserHandler;
+    UserEventContextPtr UserContextHandler;
+    void*         handler_context;
+    UserConnectionPtr UserConnectionHandler;
+    UserConnectionContextPtr UserConnectionContextHandler;
+    void*         connection_context;
     UserBytePtr UserByteReader;
+    UserByteContextPtr UserByteContextReader;
+    void*         byte_context;
     UserDoubleBytePtr UserDoubleByteReader;
-
-    bool          WriteObjectPriority         (uint8_t object, uint8_t index, uint16_t data);
+    UserDoubleByteContextPtr UserDoubleByteContextReader;
+    void*         dbyte_context;
+    UserMagicPtr  UserMagicReceiver;
+    UserMagicContextPtr UserMagicContextReceiver;
+    void*         magic_context;
+    uint8_t*      magic_buffer; /* caller's buffer for AttachMagicReceiver, filled as the report arrives */
+    uint16_t      magic_buffer_size;
+
+    bool          debug_enabled               (uint8_t level) { return level <= GENIE_LOG_LEVEL && debugSerial != nullptr; } /* constant false above GENIE_LOG_LEVEL */
+    void          poll_events                 () { if ( !main_handler_active ) DoEvents(); } /* writes from the event handler are only queued */
+    bool          handler_attached            () { return UserHandler != nullptr || UserContextHandler != nullptr; }
+    void          handler_setup               ();
+    void          magic_attach                (uint8_t *buffer, uint16_t size);
     void          writeMode                   (uint8_t *bytes, uint8_t len);
-    bool          Begin_common                ();
+    void          tx_stream                   ();
+    void          tx_send                     (uint8_t *frame);
+    bool          tx_retry                    ();
+    void          tx_fail                     (uint8_t status);
+    void          tx_abort                    ();
+    void          tx_control                  ();
+    void          tx_finish                   ();
+    uint16_t      tx_held_payload             ();
+    void          ack_measure                 (uint32_t us);
+    bool          Begin_common                (uint16_t timeout = 2000, bool report = 1);
+    void          begin_reset                 ();
+    void          probe_next                  ();
+    bool          write_object                (uint8_t object, uint8_t index, uint16_t data, uint8_t header_crc);
+    void          queue_write                 (uint8_t object, uint8_t index, uint16_t data, uint8_t header_crc);
+    uint16_t      write_fixed                 (uint8_t cmd, uint8_t index, long value, uint8_t decimals, const char *suffix);
+    uint16_t      enqueue_payload_frame       (uint8_t cmd, uint8_t index, uint8_t len, const uint8_t *payload, uint16_t payload_len);
+    void          enqueue_frame               (uint8_t *buffer, uint8_t length, bool priority = 0);
+    void          discard_frame               (uint8_t *buffer);
+    void          set_write_status            (uint16_t ticket, uint8_t status);
+    GenieShadowEntry* shadow_find             (uint8_t object, uint8_t index, bool create = 0);
+    bool          shadow_redundant            (uint8_t object, uint8_t index, uint16_t value);
+    void          shadow_store                (uint8_t object, uint8_t index, uint16_t value);
+    void          shadow_report               (uint8_t object, uint8_t index, uint16_t value, bool event = 0);
+    void          shadow_forget               (uint8_t object, uint8_t index);
+    void          shadow_mirror               (uint8_t object, uint8_t index, uint16_t value);
+    void          shadow_replay               ();
+    void          shadow_invalidate           ();
+    void          shadow_settle               (uint16_t ticket, bool acked);
+    uint16_t      read_start                  (uint8_t object, uint8_t index, UserReadPtr callback, UserReadContextPtr context_callback, void *context);
+    GenieReadRequest* read_find               (uint16_t handle);
+    int32_t       read_display                (uint8_t object, uint8_t index);
+    bool          read_finish                 (uint8_t object, uint8_t index, uint8_t status, uint16_t value = 0);
+    void          read_service                ();
+    void          link_record                 (GenieLatencyStats &stats, uint32_t us);
+    void          queue_event                 (uint8_t *frame);
+    bool          event_evict                 ();
+    int16_t       rx_parse                    (uint8_t data);
+    int16_t       rx_dispatch                 ();
+
+    // receive parser, fed one byte at a time by DoEvents and kept between calls
+    uint8_t       rx_frame[GENIE_FRAME_SIZE] = { 0 }; /* 6 byte report, or cmd, index, len of a magic report */
+    uint16_t      rx_count = 0; /* bytes of the current frame received, 0 = waiting for a command byte */
+    uint16_t      rx_expected = 0; /* length of the current frame */
+    uint8_t       rx_checksum = 0;
+    bool          rx_nak_run = 0; /* swallow the rest of a NAK burst */
+    bool          rx_magic_overflow = 0;
+    uint32_t      rx_last_byte = 0;
+#if GENIE_MAGIC_SUPPORT && GENIE_MAGIC_BUFFER_SIZE
+    Genie_Stream_Buffer < uint8_t, genie_ring_size(GENIE_MAGIC_BUFFER_SIZE) > _incomming_magic;
+#endif
+
+    // variable length frames queue a 7 byte header in _outgoing_queue: currentForm, cmd, index, len, ticket msb, ticket lsb, crc
+    // the payload itself is held in order in _outgoing_payload
+    Genie_Stream_Buffer < uint8_t, genie_ring_size(GENIE_PAYLOAD_BUFFER_SIZE) > _outgoing_payload;
+    uint16_t      tx_status_ticket[GENIE_TX_TRACKED] = { 0 };
+    uint8_t       tx_status[GENIE_TX_TRACKED] = { 0 };
+    uint16_t      tx_ticket_counter = 0;
+    uint16_t      tx_inflight_ticket = 0;
+    uint16_t      tx_stream_left = 0; /* bytes of the dequeued payload frame, crc included, not yet given to the UART */
+    uint16_t      tx_stream_pos = 0; /* next payload byte to send, counted from the head of _outgoing_payload */
+    uint8_t       tx_stream_crc = 0;
+    bool          tx_buffered = 0; /* the port reports its free transmit buffer through availableForWrite() */
+
+    // last value acknowledged by the display for each written widget
+    GenieShadowEntry shadow[GENIE_SHADOW_SIZE];
+    uint16_t      replay_pos = 2 * GENIE_SHADOW_SIZE; /* next shadow entry shadow_replay() looks at, two passes */
+    bool          shadow_full_logged = 0; /* the table full error is printed once */
+    int16_t       replay_form = -1; /* form to restore after a reconnect */
+    bool          tx_inflight_write = 0; /* a GENIE_WRITE_OBJ frame is waiting for its ACK */
+    uint8_t       tx_inflight_object = 0;
+    uint8_t       tx_inflight_index = 0;
+    uint16_t      tx_inflight_value = 0;
+
+    // queued header of the frame waiting for its ACK, kept to be sent again. A payload
+    // frame's bytes stay at the head of _outgoing_payload until tx_finish()
+    uint8_t       tx_inflight[7] = { 0 };
+    bool          tx_inflight_held = 0;
+    bool          tx_resend = 0; /* tx_inflight was NAKed or timed out and goes out again next */
+    uint8_t       tx_retries = 0;
+    uint32_t      tx_resend_since = 0;
+    uint32_t      ack_srtt = 0; /* smoothed widget write round trip, us, 0 = no sample yet */
+    uint32_t      ack_rttvar = 0;
+    uint16_t      ack_timeout = GENIE_ACK_TIMEOUT; /* ms */
+
+    uint8_t       event_append[GENIE_OBJ_ILINEAR_INPUT / 8 + 1]; /* one bit per object type, set = GENIE_EVENT_APPEND */
+    uint8_t       write_high[GENIE_OBJ_ILINEAR_INPUT / 8 + 1]; /* one bit per object type, set = GENIE_PRIORITY_HIGH */
+    uint8_t       read_mirror[GENIE_OBJ_ILINEAR_INPUT / 8 + 1]; /* one bit per object type, set = GENIE_READ_MIRROR */
+    uint8_t       tx_priority_run = 0; /* high priority frames sent in a row */
+
+    // outstanding and recently finished ReadObjectAsync() requests
+    GenieReadRequest reads[GENIE_READS_TRACKED];
+    uint16_t      read_handle_counter = 0;
+
+    GenieLinkStats link_stats;
+    uint32_t      pendingACK_sent = 0; /* micros() when the frame waiting for its ACK was sent */
+    uint32_t      autoPing_sent = 0;
 
     // used internally by the library, do not modify!
     bool          pendingACK = 0;
@@ -337,27 +720,46 @@ class Genie {
     uint8_t       NAK_recovery_counter = 0;
     bool          displayDetected = 0;
     bool          pingRequest = 0;
+    bool          ping_deferred = 0; /* Ping() waits for the frame being streamed */
+    bool          recover_deferred = 0; /* 0xFF NAK recovery byte waits the same way */
+    bool          flush_after_ping = 0; /* a 0xFF went out after the last ping, its report does not end the recovery */
     uint32_t      pingResponse = 0;
     uint32_t      pingSpacer = 0;
     uint8_t       recover_pulse = 50;
     uint32_t      display_uptime = 0;
+    uint32_t      rx_last_frame = 0; /* millis() of the last valid frame from the display, or of a payload frame still going out */
+    uint16_t      ping_idle = AUTO_PING_CYCLE;
+    uint16_t      display_timeout = DISPLAY_TIMEOUT;
     bool          genieStart = 1;
     bool          block_dequeue = 0;
     void          dequeue_processing();
-    uint8_t       magic_report_len = 0;
+    uint16_t      magic_report_len = 0;
     bool          main_handler_active = 0;
+    bool          handler_low_lane = 0; /* the event handler queued a frame in _outgoing_queue, its later writes go there too */
     bool          handler_response_request = 0;
     uint8_t       handler_response_values[6];
     uint8_t       magic_overpull_count = 0;
     uint16_t      tx_delay = 0;
+    uint32_t      baud_rate = 0; /* rate found by the baud rate probe, 0 if not probed */
+    HardwareSerial* probe_serial = nullptr; /* BeginAsync baud rate probe still running */
+    const uint32_t* probe_bauds = nullptr;
+    uint8_t       probe_count = 0;
+    uint8_t       probe_index = 0;
+    uint32_t      probe_since = 0;
+    bool          link_reported = 0; /* state last given to UserConnectionHandler */
     genieFrame    event_frame;
     friend class  GenieObject;
+    template<uint8_t, uint8_t> friend class GenieStaticObject;
 };
 
 class GenieObject {
   public:
     GenieObject   (Genie& _instance, uint8_t obj, uint8_t idx);
     int32_t read  (bool state = 1);
+    int32_t refresh ();
+    uint32_t updated ();
+    uint16_t readAsync (UserReadPtr callback = nullptr);
+    uint16_t readAsync (UserReadContextPtr callback, void *context);
     void write    (uint16_t data);
     void write    (const char * data);
 
@@ -367,4 +769,27 @@ class GenieObject {
     Genie* instance = nullptr;
 };
 
+// GenieObject for a widget known at compile time. The frame header and its
+// checksum are constants, a write only adds the two data bytes.
+//
+//    GenieStaticObject<GENIE_OBJ_USER_LED, 0> faultLed(genie);
+//    faultLed.write(1);
+
+template<uint8_t object, uint8_t index>
+class GenieStaticObject {
+  public:
+    static constexpr uint8_t header_crc = GENIE_WRITE_OBJ ^ object ^ index;
+
+    GenieStaticObject (Genie& _instance) : instance(&_instance) {}
+    int32_t read      (bool state = 1) { return instance->ReadObject(object, index, state); }
+    int32_t refresh   () { return instance->RefreshObject(object, index); }
+    uint32_t updated  () { return instance->GetMirrorTime(object, index); }
+    uint16_t readAsync (UserReadPtr callback = nullptr) { return instance->ReadObjectAsync(object, index, callback); }
+    uint16_t readAsync (UserReadContextPtr callback, void *context) { return instance->ReadObjectAsync(object, index, callback, context); }
+    bool write        (uint16_t data) { return instance->write_object(object, index, data, header_crc); }
+
+  private:
+    Genie* instance;
+};
+
 #endif
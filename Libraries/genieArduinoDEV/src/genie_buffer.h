@@ -1,553 +1,394 @@
 #ifndef Genie_Buffer_H
 #define Genie_Buffer_H
-//#include <algorithm>
 
-template<typename T, uint16_t _size, uint16_t multi = 0>
-class Genie_Buffer {
+// Ring sizes are masked with (_size-1), so they must be powers of 2.
+// genie_ring_size(n) rounds n up to the next one at compile time.
+constexpr uint16_t genie_ring_size(uint16_t n, uint16_t p = 1) { return ( p >= n ) ? p : genie_ring_size(n, p << 1); }
+
+// smallest unsigned type that can hold 0.._max
+template<bool _small> struct Genie_Slot_Type { typedef uint16_t type; };
+template<> struct Genie_Slot_Type<true> { typedef uint8_t type; };
+
+
+
+
+// ######################################
+// ## Byte stream ring                 ##
+// ######################################
+
+template<typename T, uint16_t _size>
+class Genie_Stream_Buffer {
+    static_assert(_size && !(_size & (_size - 1)), "Genie_Stream_Buffer size must be a power of 2");
     public:
 
         void push_back(T value) { return write(value); }
-        void push_front(T value);
         T pop_front() { return read(); }
-        T pop_back();
         void write(T value);
-        void push_back(const T *buffer, uint16_t length) { write(buffer, length); }
-        void write(const T *buffer, uint16_t length);
-        void push_front(const T *buffer, uint16_t length);
-        T peek(uint16_t pos = 0);
-        T peekBytes(T *buffer, uint16_t length);
         T read();
-        T pop_front(T *buffer, uint16_t length) { return readBytes(buffer,length); }
-        T peek_front(T *buffer, uint16_t length, uint32_t entry = 0);
-        T read(T *buffer, uint16_t length) { return readBytes(buffer,length); }
-        T readBytes(T *buffer, uint16_t length);
+        T peek(uint16_t pos = 0) { return ( pos < _available ) ? _buf[((head+pos)&(_size-1))] : 0; }
+        void erase(uint16_t pos, uint16_t count);
         void flush() { clear(); }
         void clear() { head = tail = _available = 0; }
-        void print(const char *p);
-        void println(const char *p);
         uint16_t size() { return _available; }
         uint16_t available() { return _available; }
         uint16_t capacity() { return _size; }
-        uint16_t length_back() { return (((int)_cabuf[((head+size()-1)&(_size-1))][0] << 8*sizeof(T)) | (int)_cabuf[((head+size()-1)&(_size-1))][1]); }
-        uint16_t length_front() { return (((int)_cabuf[((head)&(_size-1))][0] << 8*sizeof(T)) | (int)_cabuf[((head)&(_size-1))][1]); }
-        T list();
-        T variance();
-        T deviation();
-        T average();
-        bool remove(uint16_t pos);
-        T median(bool override = 0);
-        void sort_ascending();
-        void sort_descending();
-        T sum();
-        //T min();
-        //T max();
-        T mean() { return average(); }
-        T max_size() { return multi; }
-        T pop_back(T *buffer, uint16_t length);
-        T* peek_front() { return front(); } 
-        T* peek_back() { return back(); } 
-        T* front() { return _cabuf[((head)&(_size-1))]+2; }
-        T* back() { return _cabuf[((tail-1)&(_size-1))]+2; }
-        bool replace(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4 = -1, int pos5 = -1);
-        bool isEqual(const T *buffer);
-        bool find(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4 = -1, int pos5 = -1);
-        bool findRemove(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4 = -1, int pos5 = -1);
 
-    protected:
     private:
         volatile uint16_t head = 0;
         volatile uint16_t tail = 0;
         volatile uint16_t _available = 0;
-
-        T _cbuf[_size];
-        T _cabuf[_size][multi+2];
+        T _buf[_size];
 };
 
-
-template<typename T, uint16_t _size, uint16_t multi>
-bool Genie_Buffer<T,_size,multi>::remove(uint16_t pos) {
-  if ( multi ) {
-    if ( pos >= _size ) return 0;
-
-    int32_t find_area = -1;
-
-    for ( uint16_t i = 0; i < _size; i++ ) {
-      if ( ((head+i)&(_size-1)) == pos ) {
-        find_area = i;
-        break;
-      }
-    }
-    if ( find_area == -1 ) return 0;
-
-    while ( ((head+find_area)&(_size-1)) != ((head)&(_size-1)) ) {
-      memmove(_cabuf[((head+find_area)&(_size-1))],_cabuf[((head+find_area-1)&(_size-1))], (2+multi)*sizeof(T));
-      find_area--;
-    }
-    head = ((head + 1)&(2*_size-1));
-    _available--;
-    return 1;
-  }
-  return 0;
+template<typename T, uint16_t _size>
+void Genie_Stream_Buffer<T,_size>::write(T value) {
+  if ( _available < _size ) _available++;
+  _buf[((tail)&(_size-1))] = value;
+  if ( tail == ((head ^ _size)) ) head = ((head + 1)&(2*_size-1));
+  tail = ((tail + 1)&(2*_size-1));
 }
 
+template<typename T, uint16_t _size>
+T Genie_Stream_Buffer<T,_size>::read() {
+  if ( !_available ) return 0;
+  _available--;
+  T value = _buf[((head)&(_size-1))];
+  head = ((head + 1)&(2*_size-1));
+  return value;
+}
 
-
-
-template<typename T, uint16_t _size, uint16_t multi>
-bool Genie_Buffer<T, _size, multi>::findRemove(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4, int pos5) {
-  uint8_t input_count = 3;
-  int32_t found = -1;
-  if ( pos4 != -1 ) input_count = 4;
-  if ( pos5 != -1 ) input_count = 5;
-  for ( uint16_t j = 0; j < _available; j++ ) {
-    switch ( input_count ) {
-      case 3: {
-          if ( _cabuf[ ((head+j)&(_size-1)) ][pos1+2] == buffer[pos1] && _cabuf[ ((head+j)&(_size-1)) ][pos2+2] == buffer[pos2] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos3+2] == buffer[pos3] ) {
-            found = j; 
-            break;
-          }
-        }
-      case 4: {
-          if ( _cabuf[ ((head+j)&(_size-1)) ][pos1+2] == buffer[pos1] && _cabuf[ ((head+j)&(_size-1)) ][pos2+2] == buffer[pos2] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos3+2] == buffer[pos3] && _cabuf[ ((head+j)&(_size-1)) ][pos4+2] == buffer[pos4] ) {
-            found = j;
-            break;
-          }
-        }
-      case 5: {
-          if ( _cabuf[ ((head+j)&(_size-1)) ][pos1+2] == buffer[pos1] && _cabuf[ ((head+j)&(_size-1)) ][pos2+2] == buffer[pos2] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos3+2] == buffer[pos3] && _cabuf[ ((head+j)&(_size-1)) ][pos4+2] == buffer[pos4] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos5+2] == buffer[pos5] ) {
-            found = j;
-            break;
-          }
-        }
-    }
-    if ( found >= 0 ) {
-      remove(found);
-      return 1;
-    }
-  }
-  return 0;
+// Removes count elements starting pos elements after the head, moving the
+// first pos elements up to close the gap.
+template<typename T, uint16_t _size>
+void Genie_Stream_Buffer<T,_size>::erase(uint16_t pos, uint16_t count) {
+  if ( pos >= _available ) return;
+  if ( count > _available - pos ) count = _available - pos;
+  for ( uint16_t i = pos; i-- > 0; ) _buf[((head+i+count)&(_size-1))] = _buf[((head+i)&(_size-1))];
+  head = ((head + count)&(2*_size-1));
+  _available -= count;
 }
 
 
 
+// ######################################
+// ## Fixed size frame ring            ##
+// ######################################
 
+// Holds _size frames of exactly _frame elements, no per slot length header.
+// When full, pushing drops the frame at the other end.
+//
+// Keyed variant: when K1, K2 and K3 name positions in the frame, the buffer
+// keeps a hash index over those bytes so replace(), find() and findRemove()
+// called with the same positions cost O(1) instead of scanning every queued frame.
+// Calls with any other positions still scan. Removing a frame from the middle
+// moves the shorter side of the ring over the gap, at most half the queued
+// frames, and re-indexes only the frames it moved.
 
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1 = -1, int8_t K2 = -1, int8_t K3 = -1>
+class Genie_Frame_Buffer {
+    static_assert(_size && !(_size & (_size - 1)), "Genie_Frame_Buffer size must be a power of 2");
+    public:
 
+        void push_back(const T *buffer, uint16_t length = _frame) { write(buffer, length); }
+        void write(const T *buffer, uint16_t length = _frame);
+        void push_front(const T *buffer, uint16_t length = _frame);
+        T pop_front(T *buffer, uint16_t length = _frame) { return readBytes(buffer,length); }
+        T pop_back(T *buffer, uint16_t length = _frame);
+        T peek_front(T *buffer, uint16_t length = _frame, uint32_t entry = 0);
+        T readBytes(T *buffer, uint16_t length = _frame);
+        T read();
+        void flush() { clear(); }
+        void clear() { head = tail = _available = 0; if ( keyed ) memset(_index, 0, sizeof(_index)); }
+        uint16_t size() { return _available; }
+        uint16_t available() { return _available; }
+        uint16_t capacity() { return _size; }
+        uint16_t max_size() { return _frame; }
+        T* peek_front() { return front(); }
+        T* peek_back() { return back(); }
+        T* front() { return _buf[((head)&(_size-1))]; }
+        T* back() { return _buf[((tail-1)&(_size-1))]; }
+        bool remove(uint16_t pos);
+        T list();
+        bool isEqual(const T *buffer);
+        bool replace(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4 = -1, int pos5 = -1);
+        bool find(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4 = -1, int pos5 = -1);
+        bool findRemove(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4 = -1, int pos5 = -1);
 
+        // Same as above with the match positions fixed at compile time, ex. replace<1,2,3>(buffer, 7).
+        // Unused positions are left at -1 and drop out of the comparison entirely.
+        template<int8_t P1, int8_t P2 = -1, int8_t P3 = -1, int8_t P4 = -1, int8_t P5 = -1> bool replace(T *buffer, uint16_t length);
+        template<int8_t P1, int8_t P2 = -1, int8_t P3 = -1, int8_t P4 = -1, int8_t P5 = -1> bool find(T *buffer, uint16_t length);
+        template<int8_t P1, int8_t P2 = -1, int8_t P3 = -1, int8_t P4 = -1, int8_t P5 = -1> bool findRemove(T *buffer, uint16_t length);
 
+    protected:
+    private:
+        volatile uint16_t head = 0;
+        volatile uint16_t tail = 0;
+        volatile uint16_t _available = 0;
 
+        T _buf[_size][_frame];
 
+        typedef typename Genie_Slot_Type<( _size < 255 )>::type slot_t;
+        static const bool keyed = ( K1 >= 0 && K2 >= 0 && K3 >= 0 );
+        static const uint16_t _index_size = keyed ? 2 * _size : 1; /* at most half full, keeps probe chains short */
+        slot_t _index[_index_size] = { 0 }; /* physical slot + 1 of every queued frame, 0 = empty */
 
+        bool isKey(int pos1, int pos2, int pos3, int pos4, int pos5) { return keyed && pos1 == K1 && pos2 == K2 && pos3 == K3 && pos4 == -1 && pos5 == -1; }
+        uint16_t hash(const T *frame) { return ((((uint32_t)(uint8_t)frame[K1] << 16) | ((uint32_t)(uint8_t)frame[K2] << 8) | (uint8_t)frame[K3]) * 2654435761UL >> 16) & (_index_size - 1); }
+        void indexInsert(uint16_t slot);
+        void indexErase(uint16_t slot);
+        void indexMove(uint16_t from, uint16_t to);
+        int32_t indexLookup(const T *buffer);
 
+        template<int8_t P> static bool same(const T *slot, const T *buffer) { return P < 0 || slot[P < 0 ? 0 : P] == buffer[P < 0 ? 0 : P]; }
+        int32_t locate(const T *buffer, int pos1, int pos2, int pos3, int pos4, int pos5);
+        template<int8_t P1, int8_t P2, int8_t P3, int8_t P4, int8_t P5> int32_t locate(const T *buffer);
+        void overwrite(uint16_t slot, const T *buffer, uint16_t length, bool rekey);
+};
 
 
-template<typename T, uint16_t _size, uint16_t multi>
-bool Genie_Buffer<T, _size, multi>::find(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4, int pos5) {
-  uint8_t input_count = 3;
-  bool found = 0;
-  if ( pos4 != -1 ) input_count = 4;
-  if ( pos5 != -1 ) input_count = 5;
-  for ( uint16_t j = 0; j < _available; j++ ) {
-    switch ( input_count ) {
-      case 3: {
-          if ( _cabuf[ ((head+j)&(_size-1)) ][pos1+2] == buffer[pos1] && _cabuf[ ((head+j)&(_size-1)) ][pos2+2] == buffer[pos2] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos3+2] == buffer[pos3] ) {
-            found = 1; 
-            break;
-          }
-        }
-      case 4: {
-          if ( _cabuf[ ((head+j)&(_size-1)) ][pos1+2] == buffer[pos1] && _cabuf[ ((head+j)&(_size-1)) ][pos2+2] == buffer[pos2] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos3+2] == buffer[pos3] && _cabuf[ ((head+j)&(_size-1)) ][pos4+2] == buffer[pos4] ) {
-            found = 1;
-            break;
-          }
-        }
-      case 5: {
-          if ( _cabuf[ ((head+j)&(_size-1)) ][pos1+2] == buffer[pos1] && _cabuf[ ((head+j)&(_size-1)) ][pos2+2] == buffer[pos2] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos3+2] == buffer[pos3] && _cabuf[ ((head+j)&(_size-1)) ][pos4+2] == buffer[pos4] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos5+2] == buffer[pos5] ) {
-            found = 1;
-            break;
-          }
-        }
-    }
-    if ( found ) {
-      memmove(buffer, _cabuf[ ((head+j)&(_size-1)) ]+2,length*sizeof(T));
-      break;
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+void Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::indexInsert(uint16_t slot) {
+  if ( !keyed ) return;
+  uint16_t i = hash(_buf[slot]);
+  while ( _index[i] ) i = (i + 1) & (_index_size - 1);
+  _index[i] = slot + 1;
+}
+
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+void Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::indexErase(uint16_t slot) {
+  if ( !keyed ) return;
+  uint16_t i = hash(_buf[slot]);
+  while ( _index[i] != slot + 1 ) {
+    if ( !_index[i] ) return; /* not indexed */
+    i = (i + 1) & (_index_size - 1);
+  }
+  for ( uint16_t j = (i + 1) & (_index_size - 1); _index[j]; j = (j + 1) & (_index_size - 1) ) { /* backward shift the rest of the chain */
+    uint16_t home = hash(_buf[_index[j]-1]);
+    if ( ((j - home) & (_index_size - 1)) >= ((j - i) & (_index_size - 1)) ) {
+      _index[i] = _index[j];
+      i = j;
     }
   }
-  return found;
+  _index[i] = 0;
 }
 
+// Points the index entry of the frame just copied from slot from at slot to.
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+void Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::indexMove(uint16_t from, uint16_t to) {
+  if ( !keyed ) return;
+  uint16_t i = hash(_buf[to]);
+  while ( _index[i] != from + 1 ) {
+    if ( !_index[i] ) return; /* not indexed */
+    i = (i + 1) & (_index_size - 1);
+  }
+  _index[i] = to + 1;
+}
 
-template<typename T, uint16_t _size, uint16_t multi>
-bool Genie_Buffer<T, _size, multi>::replace(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4, int pos5) {
-  uint8_t input_count = 3;
-  bool found = 0;
-  if ( pos4 != -1 ) input_count = 4;
-  if ( pos5 != -1 ) input_count = 5;
-  for ( uint16_t j = 0; j < _available; j++ ) {
-    switch ( input_count ) {
-      case 3: {
-          if ( _cabuf[ ((head+j)&(_size-1)) ][pos1+2] == buffer[pos1] && _cabuf[ ((head+j)&(_size-1)) ][pos2+2] == buffer[pos2] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos3+2] == buffer[pos3] ) {
-            found = 1; 
-            break;
-          }
-          break;
-        }
-      case 4: {
-          if ( _cabuf[ ((head+j)&(_size-1)) ][pos1+2] == buffer[pos1] && _cabuf[ ((head+j)&(_size-1)) ][pos2+2] == buffer[pos2] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos3+2] == buffer[pos3] && _cabuf[ ((head+j)&(_size-1)) ][pos4+2] == buffer[pos4] ) {
-            found = 1;
-            break;
-          }
-          break;
-        }
-      case 5: {
-          if ( _cabuf[ ((head+j)&(_size-1)) ][pos1+2] == buffer[pos1] && _cabuf[ ((head+j)&(_size-1)) ][pos2+2] == buffer[pos2] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos3+2] == buffer[pos3] && _cabuf[ ((head+j)&(_size-1)) ][pos4+2] == buffer[pos4] &&
-               _cabuf[ ((head+j)&(_size-1)) ][pos5+2] == buffer[pos5] ) {
-            found = 1;
-            break;
-          }
-          break;
-        }
-    }
-    if ( found ) {
-      _cabuf[ ((head+j)&(_size-1)) ][0] = length & 0xFF00;
-      _cabuf[ ((head+j)&(_size-1)) ][1] = length & 0xFF;
-      memmove(_cabuf[ ((head+j)&(_size-1)) ]+2,buffer,length*sizeof(T));
-      break;
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+int32_t Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::indexLookup(const T *buffer) {
+  int32_t found = -1; /* position from head of the oldest matching frame */
+  for ( uint16_t i = hash(buffer); _index[i]; i = (i + 1) & (_index_size - 1) ) {
+    uint16_t slot = _index[i] - 1;
+    if ( _buf[slot][K1] == buffer[K1] && _buf[slot][K2] == buffer[K2] && _buf[slot][K3] == buffer[K3] ) {
+      int32_t j = (slot - head) & (_size-1);
+      if ( found < 0 || j < found ) found = j;
     }
   }
   return found;
 }
 
 
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+bool Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::remove(uint16_t pos) {
+  if ( pos >= _size ) return 0;
+  uint16_t i = (pos - head) & (_size-1); /* position from head */
+  if ( i >= _available ) return 0;
 
+  indexErase(pos);
+  if ( i < _available - 1 - i ) { /* fewer frames in front, move them back one */
+    for ( ; i > 0; i-- ) {
+      uint16_t to = (head+i)&(_size-1), from = (head+i-1)&(_size-1);
+      memmove(_buf[to],_buf[from], _frame*sizeof(T));
+      indexMove(from, to);
+    }
+    head = ((head + 1)&(2*_size-1));
+  }
+  else { /* move the frames behind it forward one */
+    for ( ; i < _available - 1; i++ ) {
+      uint16_t to = (head+i)&(_size-1), from = (head+i+1)&(_size-1);
+      memmove(_buf[to],_buf[from], _frame*sizeof(T));
+      indexMove(from, to);
+    }
+    tail = ((tail - 1)&(2*_size-1));
+  }
+  _available--;
+  return 1;
+}
 
 
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+int32_t Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::locate(const T *buffer, int pos1, int pos2, int pos3, int pos4, int pos5) {
+  if ( isKey(pos1, pos2, pos3, pos4, pos5) ) return indexLookup(buffer);
+  for ( uint16_t j = 0; j < _available; j++ ) {
+    const T *slot = _buf[ ((head+j)&(_size-1)) ];
+    if ( slot[pos1] == buffer[pos1] && ( pos2 < 0 || slot[pos2] == buffer[pos2] ) && ( pos3 < 0 || slot[pos3] == buffer[pos3] ) &&
+         ( pos4 < 0 || slot[pos4] == buffer[pos4] ) && ( pos5 < 0 || slot[pos5] == buffer[pos5] ) ) return j;
+  }
+  return -1;
+}
 
-
-template<typename T, uint16_t _size, uint16_t multi>
-bool Genie_Buffer<T,_size,multi>::isEqual(const T *buffer) {
-  if ( multi ) {
-    bool success = 1;
-    for ( uint16_t j = 0; j < _available; j++ ) {
-      success = 1;
-      for ( uint16_t k = 0; k < (_cabuf[ ((head+j)&(_size-1)) ][0] | _cabuf[ ((head+j)&(_size-1)) ][1]); k++ ) {
-        if ( _cabuf[ ((head+j)&(_size-1)) ][k+2] != buffer[k] ) {
-          success = 0;
-          break;
-        }
-      }
-      if ( success ) return 1;
-    }
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+template<int8_t P1, int8_t P2, int8_t P3, int8_t P4, int8_t P5>
+int32_t Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::locate(const T *buffer) {
+  static_assert(P1 < (int)_frame && P2 < (int)_frame && P3 < (int)_frame && P4 < (int)_frame && P5 < (int)_frame, "match position outside the frame");
+  if ( keyed && P1 == K1 && P2 == K2 && P3 == K3 && P4 < 0 && P5 < 0 ) return indexLookup(buffer);
+  for ( uint16_t j = 0; j < _available; j++ ) {
+    const T *slot = _buf[ ((head+j)&(_size-1)) ];
+    if ( same<P1>(slot, buffer) & same<P2>(slot, buffer) & same<P3>(slot, buffer) & same<P4>(slot, buffer) & same<P5>(slot, buffer) ) return j;
   }
-  return 0;
+  return -1;
 }
 
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+bool Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::findRemove(T *buffer, uint16_t /* length */, int pos1, int pos2, int pos3, int pos4, int pos5) {
+  int32_t j = locate(buffer, pos1, pos2, pos3, pos4, pos5);
+  if ( j < 0 ) return 0;
+  remove((head+j)&(_size-1));
+  return 1;
+}
 
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+template<int8_t P1, int8_t P2, int8_t P3, int8_t P4, int8_t P5>
+bool Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::findRemove(T *buffer, uint16_t /* length */) {
+  int32_t j = locate<P1,P2,P3,P4,P5>(buffer);
+  if ( j < 0 ) return 0;
+  remove((head+j)&(_size-1));
+  return 1;
+}
 
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+bool Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::find(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4, int pos5) {
+  int32_t j = locate(buffer, pos1, pos2, pos3, pos4, pos5);
+  if ( j < 0 ) return 0;
+  memmove(buffer, _buf[ ((head+j)&(_size-1)) ],length*sizeof(T));
+  return 1;
+}
 
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+template<int8_t P1, int8_t P2, int8_t P3, int8_t P4, int8_t P5>
+bool Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::find(T *buffer, uint16_t length) {
+  int32_t j = locate<P1,P2,P3,P4,P5>(buffer);
+  if ( j < 0 ) return 0;
+  memmove(buffer, _buf[ ((head+j)&(_size-1)) ],length*sizeof(T));
+  return 1;
+}
 
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+void Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::overwrite(uint16_t slot, const T *buffer, uint16_t length, bool rekey) {
+  if ( rekey ) indexErase(slot); /* key bytes may change */
+  memmove(_buf[slot],buffer,length*sizeof(T));
+  if ( rekey ) indexInsert(slot);
+}
 
-template<typename T, uint16_t _size, uint16_t multi>
-void Genie_Buffer<T,_size,multi>::print(const char *p) {
-  if ( multi ) return;
-  write((T*)p,strlen(p));
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+bool Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::replace(T *buffer, uint16_t length, int pos1, int pos2, int pos3, int pos4, int pos5) {
+  int32_t j = locate(buffer, pos1, pos2, pos3, pos4, pos5);
+  if ( j < 0 ) return 0;
+  overwrite((head+j)&(_size-1), buffer, length, !isKey(pos1, pos2, pos3, pos4, pos5));
+  return 1;
 }
 
-template<typename T, uint16_t _size, uint16_t multi>
-void Genie_Buffer<T,_size,multi>::println(const char *p) {
-  if ( multi ) return;
-  write((T*)p,strlen(p));
-  write('\n');
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+template<int8_t P1, int8_t P2, int8_t P3, int8_t P4, int8_t P5>
+bool Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::replace(T *buffer, uint16_t length) {
+  int32_t j = locate<P1,P2,P3,P4,P5>(buffer);
+  if ( j < 0 ) return 0;
+  overwrite((head+j)&(_size-1), buffer, length, !( keyed && P1 == K1 && P2 == K2 && P3 == K3 && P4 < 0 && P5 < 0 ));
+  return 1;
 }
 
-template<typename T, uint16_t _size, uint16_t multi>
-void Genie_Buffer<T,_size,multi>::push_front(const T *buffer, uint16_t length) {
-  if ( multi ) {
-    if ( tail == (head ^ _size) ) tail = ((tail - 1)&(2*_size-1));
-    head = ((head - 1)&(2*_size-1));
-    _cabuf[(head&(_size-1))][0] = length & 0xFF00;
-    _cabuf[(head&(_size-1))][1] = length & 0xFF;
-    memmove(_cabuf[((head)&(_size-1))]+2,buffer,length*sizeof(T));
-    if ( _available < _size ) _available++;
-    return;
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+bool Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::isEqual(const T *buffer) {
+  for ( uint16_t j = 0; j < _available; j++ ) {
+    if ( !memcmp(_buf[ ((head+j)&(_size-1)) ], buffer, _frame*sizeof(T)) ) return 1;
   }
-  for ( uint16_t i = length-1; i > 0; i-- ) push_front(buffer[i]);
-  push_front(buffer[0]);
+  return 0;
 }
 
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::pop_back() {
-  if ( _available ) {
-    if ( _available ) _available--;
+
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+void Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::push_front(const T *buffer, uint16_t length) {
+  if ( tail == (head ^ _size) ) {
     tail = ((tail - 1)&(2*_size-1));
-    return _cbuf[((tail)&(_size-1))];
+    indexErase(tail&(_size-1));
   }
-  return -1;
-}
-
-template<typename T, uint16_t _size, uint16_t multi>
-void Genie_Buffer<T,_size,multi>::push_front(T value) {
-  if ( multi ) return;
   head = ((head - 1)&(2*_size-1));
-  _cbuf[((head)&(_size-1))] = value;
+  memmove(_buf[((head)&(_size-1))],buffer,length*sizeof(T));
+  indexInsert(head&(_size-1));
   if ( _available < _size ) _available++;
 }
 
-template<typename T, uint16_t _size, uint16_t multi>
-void Genie_Buffer<T,_size,multi>::write(const T *buffer, uint16_t length) {
-  if ( multi ) {
-    _cabuf[((tail)&(_size-1))][0] = length & 0xFF00;
-    _cabuf[((tail)&(_size-1))][1] = length & 0xFF;
-    memmove(_cabuf[((tail)&(_size-1))]+2,buffer,length*sizeof(T));
-    if ( tail == ((head ^ _size)) ) head = ((head + 1)&(2*_size-1));
-    tail = ((tail + 1)&(2*_size-1));
-    if ( _available < _size ) _available++;
-    return;
-  }
-  if ( ( _available += length ) >= _size ) _available = _size;
-  if ( length < ( _size - tail ) ) {
-    memmove(_cbuf+tail,buffer,length*sizeof(T));
-    tail = ((tail + length)&(2*_size-1));
-  }
-  else for ( uint16_t i = 0; i < length; i++ ) write(buffer[i]);
-}
-
-template<typename T, uint16_t _size, uint16_t multi>
-void Genie_Buffer<T,_size,multi>::write(T value) {
-  if ( multi ) return;
-  if ( _available < _size ) _available++;
-  _cbuf[((tail)&(_size-1))] = value;
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+void Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::write(const T *buffer, uint16_t length) {
+  if ( tail == ((head ^ _size)) ) indexErase(tail&(_size-1)); /* overwriting the oldest frame */
+  memmove(_buf[((tail)&(_size-1))],buffer,length*sizeof(T));
+  indexInsert(tail&(_size-1));
   if ( tail == ((head ^ _size)) ) head = ((head + 1)&(2*_size-1));
   tail = ((tail + 1)&(2*_size-1));
+  if ( _available < _size ) _available++;
 }
 
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::list() {
-  if ( multi ) {
-    if ( !size() ) {
-      Serial.println("There are no queues available..."); return 0;
-    }
-
-    Serial.print("\nCircular Array Buffer Queue Size: "); Serial.print(size()); Serial.print(" / "); Serial.println(_size);
-
-    Serial.print("\nFirst Entry: ");
-    for ( uint16_t i = 2; i <= (((int)_cabuf[((head)&(_size-1))][0] << 8*sizeof(T)) | (int)_cabuf[((head)&(_size-1))][1])+1; i++ ) {
-      if ( (int)(_cabuf[((head+i)&(_size-1))][i]) != (T)(_cabuf[((head+i)&(_size-1))][i]) ) { // possible float?
-        Serial.print(_cabuf[((head)&(_size-1))][i],7);
-      }
-      else Serial.print(_cabuf[((head)&(_size-1))][i]);
-      Serial.print("    ");
-    } Serial.print("("); Serial.print((((int)_cabuf[((head)&(_size-1))][0] << 8*sizeof(T)) | (int)_cabuf[((head)&(_size-1))][1])); Serial.println(" entries.)");
-
-    Serial.print("Last Entry:  ");
-    for ( uint16_t i = 2; i <= (((int)_cabuf[((head+size()-1)&(_size-1))][0] << 8*sizeof(T)) | (int)_cabuf[((head+size()-1)&(_size-1))][1])+1; i++ ) {
-      if ( (int)(_cabuf[((head+size()-1)&(_size-1))][i]) != (T)(_cabuf[((head+size()-1)&(_size-1))][i]) ) { // possible float?
-        Serial.print(_cabuf[((head+size()-1)&(_size-1))][i],7);
-      }
-      else Serial.print(_cabuf[((head+size()-1)&(_size-1))][i]);
-      Serial.print("    ");
-    } Serial.print("("); Serial.print((((int)_cabuf[((head+size()-1)&(_size-1))][0] << 8*sizeof(T)) | (int)_cabuf[((head+size()-1)&(_size-1))][1])); Serial.println(" entries.)");
-
-    Serial.print("\n[Indice]      [Entries]\n\n"); 
-    for ( uint16_t i = 0; i < size(); i++ ) {
-      Serial.print("    ");
-      Serial.print(((head+i)&(_size-1)));
-      Serial.print("\t\t");
-      for ( uint16_t j = 2; j <= (((int)_cabuf[((head+i)&(_size-1))][0] << 8*sizeof(T)) | (int)_cabuf[((head+i)&(_size-1))][1])+1; j++ ) {
-        if ( (int)(_cabuf[((head+i)&(_size-1))][j]) != (T)(_cabuf[((head+i)&(_size-1))][j]) ) { // possible float?
-          Serial.print(_cabuf[((head+i)&(_size-1))][j],7); Serial.print("\t");
-        }
-        else {
-          Serial.print(_cabuf[((head+i)&(_size-1))][j]); Serial.print("\t");
-        }
-      } Serial.print("("); Serial.print((((int)_cabuf[((head+i)&(_size-1))][0] << 8*sizeof(T)) | (int)_cabuf[((head+i)&(_size-1))][1])); Serial.println(" entries.)");
-    }
-    return _available;
-  }
-
-
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+T Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::list() {
   if ( !size() ) {
     Serial.println("There are no queues available..."); return 0;
   }
-  Serial.print("\nCircular Ring Buffer Queue Size: "); Serial.print(size()); Serial.print(" / "); Serial.println(_size);
 
-  Serial.print("\nIndice:  \t"); 
+  Serial.print("\nCircular Frame Buffer Queue Size: "); Serial.print(size()); Serial.print(" / "); Serial.println(_size);
 
-  for ( uint16_t i = 0; i < _available; i++ ) {
-    Serial.print("[");
-    Serial.print((head+i)&(_size-1)); Serial.print("]      \t");
+  Serial.print("\n[Indice]      [Entries]\n\n");
+  for ( uint16_t i = 0; i < size(); i++ ) {
+    Serial.print("    ");
+    Serial.print(((head+i)&(_size-1)));
+    Serial.print("\t\t");
+    for ( uint16_t j = 0; j < _frame; j++ ) {
+      Serial.print(_buf[((head+i)&(_size-1))][j]); Serial.print("\t");
+    } Serial.println();
   }
-
-  Serial.print("\nEntries:\t");
-
-  for ( uint16_t i = 0; i < _available; i++ ) {
-    if ( (int)_cbuf[((head+i)&(_size-1))] != (T)_cbuf[((head+i)&(_size-1))] ) { // possible float?
-      Serial.print(_cbuf[((head+i)&(_size-1))],7); Serial.print("\t");
-    }
-    else {
-      Serial.print(_cbuf[((head+i)&(_size-1))]); Serial.print("\t\t");
-    }
-  } Serial.println('\n');
-
-
-
-
   return _available;
 }
 
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::sum() {
-  if ( multi || !_available ) return 0;
-  T value = 0;
-  for ( uint16_t i = 0; i < _available; i++ ) value += _cbuf[((head+i)&(_size-1))];
-  return value;
-}
-
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::average() {
-  if ( multi || !_available ) return 0;
-  return sum()/_available;
-}
-
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::variance() {
-  if ( multi || !_available ) return 0;
-  T _mean = average();
-  T value = 0;
-  for ( uint16_t i = 0; i < _available; i++ ) {
-    value += ((_cbuf[((head+i)&(_size-1))] - _mean) * (_cbuf[((head+i)&(_size-1))] - _mean));
-  }
-  value /= _available;
-  return value;
-}
-
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::deviation() {
-  if ( multi || !_available ) return 0;
-  return sqrt(variance());
-}
-
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::peek(uint16_t pos) {
-  if ( multi ) return 0;
-  if ( pos > _size ) return 0;
-  return _cbuf[((head+pos)&(_size-1))];
-}
-
-//template<typename T, uint16_t _size, uint16_t multi>
-//void Genie_Buffer<T,_size,multi>::sort_ascending() {
-//  if ( multi || !_available ) return;
-//  T buffer[_available];
-//  for ( uint16_t i = 0; i < _available; i++ ) buffer[i] = _cbuf[((head+i)&(_size-1))];
-//  std::sort(&buffer[0], &buffer[_available]); // sort ascending
-//  for ( uint16_t i = 0; i < _available; i++ ) _cbuf[((head+i)&(_size-1))] = buffer[i];
-//}
-
-//template<typename T, uint16_t _size, uint16_t multi>
-//void Genie_Buffer<T,_size,multi>::sort_descending() {
-//  if ( multi || !_available ) return;
-//  sort_ascending();
-//  T buffer[_available];
-//  for ( uint16_t i = 0; i < _available; i++ ) buffer[i] = _cbuf[((head+i)&(_size-1))];
-//  std::reverse(&buffer[0], &buffer[_available]); // sort descending
-//  for ( uint16_t i = 0; i < _available; i++ ) _cbuf[((head+i)&(_size-1))] = buffer[i];
-//}
-
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::median(bool override) {
-  if ( multi || !_available ) return 0;
-  if ( override ) sort_ascending();
-  else {
-    T buffer[_available];
-    for ( uint16_t i = 0; i < _available; i++ ) buffer[i] = _cbuf[((head+i)&(_size-1))];
-//    std::sort(&buffer[0], &buffer[_available]); // sort ascending
-  }
-  if ( !(_available % 2) ) {
-    return ( _cbuf[((head+((_available/2)-1))&(_size-1))]  +  _cbuf[((head+(_available/2))&(_size-1))] ) /2;
-  }
-  else return _cbuf[((head+((_available/2)))&(_size-1))];  
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+T Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::peek_front(T *buffer, uint16_t length, uint32_t entry) {
+  memmove(&buffer[0],&_buf[((head+entry)&(_size-1))][0],length*sizeof(T));
   return 0;
 }
 
-//template<typename T, uint16_t _size, uint16_t multi>
-//T Genie_Buffer<T,_size,multi>::max() {
-//  if ( multi || !_available ) return 0;
-//  T buffer[_available];
-//  for ( uint16_t i = 0; i < _available; i++ ) buffer[i] = _cbuf[((head+i)&(_size-1))];
-//  std::sort(&buffer[0], &buffer[_available]); // sort ascending
-//  return buffer[_available-1];
-//}
-//template<typename T, uint16_t _size, uint16_t multi>
-//T Genie_Buffer<T,_size,multi>::min() {
-//  if ( multi || !_available ) return 0;
-//  T buffer[_available];
-//  for ( uint16_t i = 0; i < _available; i++ ) buffer[i] = _cbuf[((head+i)&(_size-1))];
-//  std::sort(&buffer[0], &buffer[_available]); // sort ascending
-//  return buffer[0];
-//}
-
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::peekBytes(T *buffer, uint16_t length) {
-  if ( multi ) return 0;
-  uint16_t _count = ( _available < length ) ? _available : length;
-  if ( _count < ( _size - head ) ) memmove(buffer,_cbuf+head,_count*sizeof(T));
-  else for ( uint16_t i = 0; i < _count; i++ ) buffer[i] = peek(i);
-  return _count;
-}
-
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::peek_front(T *buffer, uint16_t length, uint32_t entry) {
-  if ( multi ) {
-    memmove(&buffer[0],&_cabuf[((head+entry)&(_size-1))][2],length*sizeof(T)); // update CA buffer
-    return 0;
-  }
-}
-
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::readBytes(T *buffer, uint16_t length) {
-  if ( multi ) {
-    memmove(&buffer[0],&_cabuf[((head)&(_size-1))][2],length*sizeof(T)); // update CA buffer
-    read();
-    return 0;
-  }
-  uint16_t _count = ( _available < length ) ? _available : length;
-  if ( _count < ( _size - head ) ) memmove(buffer,_cbuf+head,_count*sizeof(T));
-  else for ( uint16_t i = 0; i < _count; i++ ) buffer[i] = read(); // if buffer rollover
-  return _count;
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+T Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::readBytes(T *buffer, uint16_t length) {
+  memmove(&buffer[0],&_buf[((head)&(_size-1))][0],length*sizeof(T));
+  read();
+  return 0;
 }
 
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::read() {
-  if ( multi ) {
-    head = ((head + 1)&(2*_size-1));
-    if ( _available ) _available--;
-    return 0;
-  }
-  if ( _available ) _available--;
-  T value = _cbuf[((head)&(_size-1))];
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+T Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::read() {
+  if ( !_available ) return 0;
+  indexErase(head&(_size-1));
   head = ((head + 1)&(2*_size-1));
-  return value;
+  _available--;
+  return 0;
 }
 
-template<typename T, uint16_t _size, uint16_t multi>
-T Genie_Buffer<T,_size,multi>::pop_back(T *buffer, uint16_t length) {
-  if ( multi ) {
-    memmove(&buffer[0],&_cabuf[((tail-1)&(_size-1))][2],length*sizeof(T));
-    tail = (tail - 1)&(2*_size-1);
-    if ( _available ) _available--;
-    return 0;
-  }
+template<typename T, uint16_t _size, uint16_t _frame, int8_t K1, int8_t K2, int8_t K3>
+T Genie_Frame_Buffer<T,_size,_frame,K1,K2,K3>::pop_back(T *buffer, uint16_t length) {
+  if ( !_available ) return 0;
+  memmove(&buffer[0],&_buf[((tail-1)&(_size-1))][0],length*sizeof(T));
+  indexErase((tail-1)&(_size-1));
+  tail = (tail - 1)&(2*_size-1);
+  _available--;
+  return 0;
 }
 
 #endif // Genie_Buffer_H
@@ -43,6 +43,8 @@ float OffsetMM = 116.02; //Current offset is 116.11 MM, measured from back of cl
 
 
 Genie genie;
+GenieStaticObject<GENIE_OBJ_USER_LED, 0> FaultLed(genie);       // faultLEDGenieNum, frame header built at compile time
+GenieStaticObject<GENIE_OBJ_LED_DIGITS, 1> EditDigits(genie);   // LED digits of the Edit Parameter screen
 
 //----------------------------------------------------------------------------------------
 // Define the ClearCore COM port connected to the HMI
@@ -57,6 +59,14 @@ Genie genie;
 // ClearCore Baud Rate, for 4D Display
 #define baudRate 9600
 
+// Rates the 4D Display may be programmed with, tried in turn by genie.BeginAsync().
+// Putting the fast rate first lets the HMI project move to 115200 without breaking older displays at 9600.
+const uint32_t hmiBaudRates[] = { 115200, 9600 };
+
+// MagicObject running HMIContentRedo/MagicBatchWrite.4dg. Uncomment once the HMI project has it,
+// the main screen is then refreshed with one frame and one ACK instead of one per widget.
+// #define HMI_BATCH_MAGIC 0
+
 
 int i, k;
 char text[100];
@@ -72,7 +82,6 @@ int SecondsInMinute = 60;             // Seconds in a minute
 
 //Stored Variables and defaults
 int MoveDist = 0;
-int MoveDistLast = 0;
 bool fault = false;
 int NextForm = 0;
 int CutPosition = 0;
@@ -84,7 +93,7 @@ float UnitFactor = UnitMM;  //Default: Millimeters to steps
 float LengthMin = OffsetMM*UnitMM;         //Offset to account for clamp depth and distance from blade
 float LengthMax = 550000;               //Length in steps from blade
 bool UserUnits = true;
-String Units = "Millimeters";         //Default Units
+const char *Units = "Millimeters";    //Default Units
 float UnitMin = LengthMin/UnitMM; //Minimum length in millimeters, updated later
 float UnitMax = LengthMax/UnitMM; //Maximum length in millimeters, updated later
 
@@ -107,7 +116,6 @@ int FinishedCuttingGenieNum = 6;
 int CutSameGenieNum = 7;
 int NewCutGenieNum = 8;
 
-int EditInputDigitNum = 1;
 int BackGenieNum = 9;
 int KeypadGenieNum = 0;
 
@@ -135,19 +143,15 @@ void setup() {
 
   delay(3000); // Delay to allow Terminal to wake up to capture first debug messages
 
-  while (!genie.Begin(SerialPort));
+  // Returns at once, genie.DoEvents() in loop() finds the display while the motor is enabled and homed
+  genie.BeginAsync(SerialPort, hmiBaudRates, sizeof(hmiBaudRates) / sizeof(hmiBaudRates[0]));
+  genie.AttachEventHandler(myGenieEventHandler); // Attach the user function Event Handler for processing events
+  genie.AttachConnectionHandler(myGenieConnectionHandler); // Called when the display comes online or goes offline
 
-  if (genie.IsOnline()) // When the display has responded above, do the following once its online
-  {
-    genie.AttachEventHandler(myGenieEventHandler); // Attach the user function Event Handler for processing events
-    Serial.println("Genie attached"); 
-  }
   resetMotor();
 
-  genie.SetForm(0); // Change to Form 0 
+  genie.SetForm(0); // Change to Form 0, sent once the display is online
   CurrentForm = 0;
-
-  genie.WriteContrast(15); // Max Brightness (0-15 range)
 }
 
 void loop() {
@@ -178,12 +182,18 @@ void loop() {
       /************************************* FORM actions *********************************************/
       
       case 1: //main screen
-        if (UserDist != MoveDistLast)
-          {
-            genie.WriteObject(GENIE_OBJ_LED_DIGITS, DistGenieNum, UserDist); // Update Move Distance
-            MoveDistLast = UserDist;
-          }
-          
+#ifdef HMI_BATCH_MAGIC
+        {
+          GenieWrite mainScreen[] = {
+            { GENIE_OBJ_LED_DIGITS, (uint8_t)DistGenieNum, (uint16_t)UserDist },
+            { GENIE_OBJ_ISWITCH, (uint8_t)UnitSwitchNum0, UserUnits },
+          };
+          genie.WriteObjects(HMI_BATCH_MAGIC, mainScreen, 2); // Move Distance and units, the library leaves out unchanged widgets
+          // The fault LED stays out of the batch, writes to a batched widget wait in the low priority lane behind the batch
+        }
+#else
+        genie.WriteObject(GENIE_OBJ_LED_DIGITS, DistGenieNum, UserDist); // Update Move Distance, the library skips it while unchanged
+#endif
         break;
 
       case 2: //Motor In Motion Screen 
@@ -216,25 +226,35 @@ void loop() {
       
     }
 
-      // If a new fault is detected, turn on the  fault LED
+      // Report a newly detected fault
       if (motor.StatusReg().bit.AlertsPresent && !fault)
       {
-        fault = true;
         Serial.println(" status: 'In Alert'");
-        genie.WriteObject(GENIE_OBJ_USER_LED, 0, 1);//Set user led 1, to value 1(On)
-      }
-      // If the fault has sucessfully been cleared, turn off the  fault LED
-      else if (!motor.StatusReg().bit.AlertsPresent && fault)
-      {
-        fault = false;
-        genie.WriteObject(GENIE_OBJ_USER_LED, 1, 0);
       }
+      fault = motor.StatusReg().bit.AlertsPresent;
+      // Mirror the fault onto the fault LED, the library only sends it when it changes, ahead of queued digit updates
+      FaultLed.write(fault);
 
     waitPeriod = millis() + 50; // rerun this code in another 50ms time.
   }
 }
 
 
+void myGenieConnectionHandler(bool online)
+{
+  if (online)
+  {
+    Serial.print("Genie attached at ");
+    Serial.print(genie.GetBaudRate());
+    Serial.println(" baud");
+    genie.WriteContrast(15); // Max Brightness (0-15 range)
+  }
+  else
+  {
+    Serial.println("Genie display offline");
+  }
+}
+
 void myGenieEventHandler(void)
 {
   genieFrame Event;
@@ -346,7 +366,7 @@ void myGenieEventHandler(void)
             PreviousForm = 1;                                         // Always return to the main screen
             LEDDigitToEdit = DistGenieNum;                     // The LED Digit which will take this edited value
             DigitsToEdit = 5;                                             // The number of Digits (4 or 5)
-            genie.WriteObject(GENIE_OBJ_LED_DIGITS, EditInputDigitNum, 0);               // Clear any previous data from the Edit Parameter screen //FIXME
+            EditDigits.write(0);                                             // Clear any previous data from the Edit Parameter screen //FIXME
             genie.SetForm(6);                                               // Change to Form 6 - Edit Parameter
             Serial.println("Edit passed");
           }//else alert user something here
@@ -465,7 +485,7 @@ void myGenieEventHandler(void)
           }
           counter = 0;
   
-          genie.WriteObject(GENIE_OBJ_LED_DIGITS, EditInputDigitNum, 0);               // Undo changes visible on keypad
+          EditDigits.write(0);                                             // Undo changes visible on keypad
           genie.SetForm(PreviousForm);                                  // Change to Previous Form
         }
       }
@@ -492,7 +512,7 @@ void myGenieEventHandler(void)
             }
           }
 
-          genie.WriteObject(GENIE_OBJ_LED_DIGITS, EditInputDigitNum, sumTemp);           // Prints to LED Digit 18 on Form 5 (max the LED digits can take is 65535)
+          EditDigits.write(sumTemp);                                       // Prints to LED Digit 18 on Form 5 (max the LED digits can take is 65535)
           counter = counter + 1;                                          // Increment array to next position ready for next key press
         }
         else if (temp == 8)                                               // Check if 'Backspace' Key
@@ -501,7 +521,7 @@ void myGenieEventHandler(void)
           {
             counter--;                                                    // Decrement the counter to the previous key
             keyvalue[counter] = 0;                                        // Overwrite the position in the array with 0 / null
-            genie.WriteObject(GENIE_OBJ_LED_DIGITS, EditInputDigitNum, atoi(keyvalue));  // Prints the current array value (as an integer) to LED Digit 18 on Form 5
+            EditDigits.write(atoi(keyvalue));                                // Prints the current array value (as an integer) to LED Digit 18 on Form 5
           }
         }
         else if (temp == 13)                                              // Check if 'Enter' Key